@@ -1,7 +1,18 @@
-#include "raylib.h" // raylib functions and types
+#include "raylib.h"      // raylib functions and types
+#include "snakebundle.h" // Sprites and sounds packed into one file that is mapped instead of decoded
+#include "snakemcts.h"   // Monte Carlo tree search bot (plays the headless rules in snakeenv)
+#include <pthread.h>   // Asset decoding threads
+#include <stdarg.h>    // va_list
+#include <stdatomic.h> // atomic_int
+#include <math.h>   // cosf/sinf
 #include <stdio.h>  // c standard library functions and types
 #include <stdlib.h> // malloc
-#include <time.h>   // rand/time
+#include <stdint.h> // uint64_t
+#include <string.h> // memset/memcpy
+#include <time.h>   // rand/time/clock_gettime
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // AVX2 flood fill and particle update
+#endif
 
 // Board contents
 #define EMPTY 0
@@ -29,7 +40,106 @@
 #define CLOSING 2 // Closes on the snake move after opening if the snake hasnt eaten food
 #define EATING 3  // Snake is eating food (Goes to CLOSED state as eating animation includes closing snakes mouth)
 
-Color DARKERLIGHTGRAY = (Color){180, 180, 180, 255}; // One of the alternating background colours (the other is default raylib LIGHTGRAY)
+// Autopilot distance field
+#define UNREACHABLE 0x3fffffff // Distance of a cell that has no path to the food
+#define QUEUED 1               // Cell is waiting to be checked after a cell on its path was blocked
+#define AFFECTED 2             // Cell lost all of its shortest paths to the food and needs a new distance
+
+// Autopilot modes
+#define AUTOPILOTOFF 0 // Player controls the snake
+#define PATHFINDER 1   // Follows the shortest path to the food
+#define HAMILTONIAN 2  // Follows a cycle through every cell (taking safe shortcuts) so it always fills the board
+#define MONTECARLO 3   // Searches with Monte Carlo tree search on every CPU core until just before the snake moves
+#define AUTOPILOTMODES 4
+#define CYCLECACHESIZE 8 // Number of board sizes to keep computed Hamiltonian cycles for
+
+// Board camera
+#define CHUNKPIXELS 512        // Width and height in pixels of a cached chunk of the board background (the cells in a chunk depend on the zoom)
+#define CHUNKCACHESIZE 32      // Chunk render textures kept (enough to cover the screen a few times over)
+#define FOLLOWCELLSIZE 20      // Cell size used when the whole board doesnt fit on the screen (the size of the sprites so they are drawn pixel for pixel)
+#define MINCELLSIZE 1          // Smallest cell size the camera can zoom out to
+#define LODCELLSIZE 6          // Cells smaller than this are drawn from the board overview (one texel per cell) instead of with sprites
+#define MAXCELLSIZE 60         // Biggest cell size the camera can zoom in to (3 times the size of the sprites)
+#define CAMERAFOLLOWSPEED 8.0f // How quickly the camera catches up with the front of the snake (fraction of the distance each second)
+
+// Minimap (shown in the corner when the board doesnt fit on the screen)
+#define MINIMAPSIZE 160     // Most texels along each side of the minimap (bigger boards have a block of cells for each texel)
+#define MINIMAPPIXELS 160   // Width and height of the minimap on the screen
+#define MINIMAPDIRTYSIZE 64 // Changed texels remembered between uploads (more changes than this rebuild the whole minimap)
+
+// Snake renderer
+#define ATLASFRAMESIZE 20                       // Width and height in pixels of one frame of a snake sprite (sprites of other heights arent put in the atlas)
+#define ATLASWIDTH (10 * ATLASFRAMESIZE)        // Width of the atlas (the death animation is two cells wide so its frames are twice as wide)
+#define SNAKEQUADLAYERS 4                       // Quads in the slot of each snake cell (entering, leaving, food layer and mouth top layer)
+#define SNAKESLOTVERTICES (SNAKEQUADLAYERS * 6) // Vertices in one slot (two triangles for each quad)
+#define SNAKEQUADCAPACITY 8192                  // Snake cells the vertex buffer has slots for (longer snakes are drawn a sprite at a time)
+
+// Palette (sprites and the board are stored as indices into it and coloured by the skin)
+#define PALETTESIZE 256     // Colours in the palette (indices are 8 bit)
+#define PALETTEBLANK 0      // See-through (every pixel with no alpha)
+#define PALETTEBOARDLIGHT 1 // Checkerboard colours and walls (looked up from the skin)
+#define PALETTEBOARDDARK 2
+#define PALETTEWALL 3
+#define PALETTEFIXED 4      // Colours of the sprites are added after the fixed entries
+#define SKINCOUNT 4
+
+// Particles (bursts of little sprites when the snake eats, dies and wins)
+#define PARTICLECAPACITY 131072 // Live particles the pool holds (new particles are dropped while it is full)
+#define PARTICLEVERTICES 6      // Vertices of each particle (two triangles)
+#define PARTICLEGRAVITY 12.0f   // Cells per second each particle falls faster every second
+#define PARTICLEFOOD 0          // Sprites particles are drawn with
+#define PARTICLEBODY 1
+#define PARTICLESPRITES 2
+#define EATPARTICLES 48  // Particles when the snake eats
+#define DEATHPARTICLES 6 // Particles from each part of the snake when it dies
+#define WINPARTICLES 4   // Particles from each part of the snake when it fills the board
+
+// Cached text (each piece of text on the screen is kept in its own texture, see drawCachedText)
+#define HUDHELP 0           // Help text down the left of the board (HUDHELPPIECES pieces)
+#define HUDHELPPIECES 7
+#define HUDSCORE 7
+#define HUDDIFFICULTY 8
+#define HUDAUTOPILOT 9
+#define HUDPAUSED 10
+#define HUDTITLE 11         // Big text at the top of the menus
+#define HUDRESULT 12        // Score on the death screen
+#define HUDMENUDIFFICULTY 13
+#define HUDPROMPT 14        // Press enter text at the bottom of the menus
+#define HUDSKIN 15          // Name of the skin
+#define HUDTEXTCOUNT 16
+#define TEXTLEFT 0          // Text alignment ('x' is the left edge, the middle or the right edge of the text)
+#define TEXTCENTER 1
+#define TEXTRIGHT 2
+#define TEXTLINESPACING 2   // Gap in pixels raylib leaves between lines of text
+
+// Frame pacing
+#define FULLFPS 60              // Frame rate while playing
+#define PAUSEDFPS 10            // Frame rate once a paused game has had no input for 'PAUSEDIDLESECONDS'
+#define PAUSEDIDLESECONDS 1.0   // Input keeps a paused game at the full frame rate for this long
+#define PACINGSTATES 6          // States CPU use is recorded for (the game states and PAUSEDSTATE)
+#define PAUSEDSTATE 5           // Game state while paused
+
+// Snake skin and colour theme of the board (the snake sprites are grays so a skin blends each gray between 'dark' and 'light', other
+// colours like the food and the tongue are kept)
+typedef struct
+{
+    const char *name;
+    Color dark;       // Colour black parts of the snake become
+    Color light;      // Colour white parts of the snake become
+    Color boardLight; // Alternating background colours
+    Color boardDark;
+    Color wall;
+} Skin;
+
+Skin skins[SKINCOUNT] = {
+    {"CLASSIC", BLACK, WHITE, LIGHTGRAY, (Color){180, 180, 180, 255}, DARKGRAY},
+    {"JUNGLE", (Color){10, 50, 20, 255}, (Color){170, 230, 140, 255}, (Color){196, 214, 160, 255}, (Color){174, 194, 138, 255}, (Color){72, 92, 52, 255}},
+    {"OCEAN", (Color){10, 30, 80, 255}, (Color){150, 200, 255, 255}, (Color){190, 212, 232, 255}, (Color){166, 190, 214, 255}, (Color){44, 64, 96, 255}},
+    {"HIGH CONTRAST", BLACK, (Color){255, 220, 0, 255}, WHITE, (Color){215, 215, 215, 255}, (Color){0, 0, 160, 255}},
+};
+int currentSkin = 0;
+Color spritePalette[PALETTESIZE]; // Colours of the sprites before the skin is applied (the fixed entries are taken from the skin)
+int paletteCount = PALETTEFIXED;  // Entries in use
 
 // Global variables
 int boardSize; // Width and height of the playable board + 2 for the boarder
@@ -41,6 +151,38 @@ float pausedStartTime = 0.0f; // Stores the start time that the game was paused
 // Stores the length of time the game was paused for
 float totalPausedTime = 0.0f; // Used to account for the time spent in the pause menu when calculating when the snake next needs to move
 int DeathType = BOARDWALL;    // Stores the way the snake died (Hitting a wall or hitting the snake) used to display the correct death animation
+uint64_t rngState = 0;        // State of the random number generator used to place food (kept in game snapshots)
+uint64_t gameTick = 0;        // Number of times the snake has moved this game
+uint64_t cycleOrderTick = UINT64_MAX; // 'gameTick' the snake is known to lie along the Hamiltonian cycle from its tail to its front at (UINT64_MAX if it isnt known)
+unsigned boardGeneration = 1; // Incremented when a new game starts on the same board so the cells dont all have to be rewritten
+unsigned boardDrawCount = 0;  // Number of times the board has been drawn
+int builtBoardSize = 0;       // Board size the walls of the board were last built for (0 if the board needs building)
+uint64_t positionHash = 0;    // Zobrist hash of the snake cells, the food and the direction the snake is moving in (updated as they change)
+int customBoardSize = 0;      // Playable board size given on the command line (0 uses the size from the difficulty)
+int autopilotMode = AUTOPILOTOFF; // Stores who is steering the snake (AUTOPILOTOFF, PATHFINDER, HAMILTONIAN)
+double autopilotTime = 0.0;       // Total time the autopilot has spent choosing moves this game (seconds)
+int autopilotMoveCount = 0;       // Number of moves the autopilot has chosen this game
+double autopilotStartTime = 0.0;  // Time the autopilot started playing the current game (used to report how long it took to win)
+void *quickSave = NULL;           // Game snapshot saved with [F5] and loaded with [F9]
+MctsBot *mctsBot = NULL;          // Worker threads for the Monte Carlo autopilot (started the first time it is used)
+int mctsThreadCount = 0;          // Threads for the Monte Carlo autopilot (0 uses every CPU core)
+int *mctsBody = NULL;             // Snake cells passed to snakeenv by the Monte Carlo search and the rules check (allocated for the biggest board)
+uint64_t mctsSearchTick = 0;      // 'gameTick' and 'positionHash' of the position being searched (a new search is started when they change)
+uint64_t mctsSearchHash = 0;
+uint64_t mctsRollouts = 0;        // Lines played out by the Monte Carlo autopilot this game
+double mctsSearchTime = 0.0;      // Time the Monte Carlo autopilot has spent searching this game (seconds)
+bool checkRules = false;          // Plays every move of the game again with the rules in snakeenv and reports any difference (set with --check-rules)
+SnakeEnv *rulesEnvs[4] = {NULL};  // Rules for the board of each difficulty (created when the game starts so checking doesnt allocate while playing)
+int rulesEnvSizes[4] = {0};       // Board size (walls included) each of 'rulesEnvs' was created for
+SnakeEnv *rulesEnv = NULL;        // Rules the move being checked was played with (NULL if no move is being checked)
+bool rulesDone = false;           // Snake died or won in 'rulesEnv' on the move being checked
+unsigned backgroundVersion = 0;   // Incremented when the walls of the board change (cached chunks from an older version are redrawn)
+Vector2 cameraCenter;             // Point of the board (in pixels from the top left of the board) the camera is centred on
+bool cameraSnap = true;           // Move the camera straight to the snake instead of following it (set for a new board or zoom)
+RenderTexture2D screenTarget;     // Whole frame drawn at 'screenWidth' by 'screenHeight' then scaled up to fill the window
+RenderTexture2D boardTarget;      // Board drawn with cells the size of the sprites then scaled up to the cell size (so every sprite pixel is the same size)
+RenderTexture2D *renderTargets[4]; // Render targets being drawn into (raylib cant nest texture modes so the one underneath is bound again when one ends)
+int renderTargetCount = 0;
 
 typedef struct
 {
@@ -48,15 +190,22 @@ typedef struct
     int y;
 } Position;
 
+// Snake or food sprite (drawn from row 'atlasRow' of the sprite atlas once it is loaded, until then from its own texture)
+typedef struct
+{
+    Texture2D texture; // Only drawn from if the sprite isnt in the atlas or the atlas isnt loaded (unloaded once it is)
+    int atlasRow;      // Row of the atlas the sprite is in (each row holds the 5 frames of one sprite, -1 if it isnt in the atlas)
+} Sprite;
+
 typedef struct
 {
-    Texture2D main;
-    Texture2D left;
-    Texture2D right;
+    Sprite main;
+    Sprite left;
+    Sprite right;
 
     // For snake mouth eat and close animations as they are made of three layers (main, layer1, layer2)
-    Texture2D layer1;
-    Texture2D layer2;
+    Sprite layer1;
+    Sprite layer2;
 } SpriteVariants; // Stores the different varients of a sprite such as turning left varient
 
 typedef struct
@@ -67,9 +216,9 @@ typedef struct
 
 int snakeMouthState = CLOSED; // Stores the state the snakes mouth is currently in
 int snakeSpriteFrame = 0;     // Stores the current animation frame that all the parts of the snake are in
-Texture2D FoodSprite;
-Texture2D SnakeDeathWallSprite;  // When snake hits a wall
-Texture2D SnakeDeathSnakeSprite; // When snake hits itself
+Sprite FoodSprite;
+Sprite SnakeDeathWallSprite;  // When snake hits a wall
+Sprite SnakeDeathSnakeSprite; // When snake hits itself
 
 // Snake front sprites
 SpriteCollection SnakeHeadSprites;       // Mouth closed
@@ -91,21 +240,361 @@ Sound SwitchScreen;
 Sound SnakeEat;
 Sound SnakeDeath;
 
+// Sprite and sound files decoded on worker threads while the window opens (only uploading them needs the main thread)
+// Files found in the asset bundle arent decoded at all, their image or wave points straight at the mapped bundle
+typedef struct
+{
+    const char *fileName;
+    Sprite *sprite;      // Sprite created from the file (NULL for sounds)
+    Sound *sound;        // Sound created from the file (NULL for sprites)
+    Image image;         // Decoded sprite waiting to be uploaded
+    Wave wave;           // Decoded sound waiting to be created
+    bool mapped;         // 'image' or 'wave' is in the asset bundle (so it isnt freed after use)
+    atomic_bool decoded; // Set by the thread that decoded the asset once 'image' or 'wave' is ready
+    bool loaded;         // Texture or sound has been created on the main thread
+} Asset;
+
+Asset assets[] = {
+    {.fileName = "resources/snakeSprites/EnterOrLeaveEmpty.png", .sprite = &EmptyCellSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/HeadEnter.png", .sprite = &SnakeHeadSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/HeadLeave.png", .sprite = &SnakeHeadSprites.leavingCell.main},
+    {.fileName = "resources/snakeSprites/HeadLeaveLeft.png", .sprite = &SnakeHeadSprites.leavingCell.left},
+    {.fileName = "resources/snakeSprites/HeadLeaveRight.png", .sprite = &SnakeHeadSprites.leavingCell.right},
+    {.fileName = "resources/snakeSprites/HeadDeathWall.png", .sprite = &SnakeDeathWallSprite},
+    {.fileName = "resources/snakeSprites/HeadDeathSnakebody.png", .sprite = &SnakeDeathSnakeSprite},
+    {.fileName = "resources/snakeSprites/HeadEatEnterBottom.png", .sprite = &SnakeMouthEatSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/HeadEatEnterFood.png", .sprite = &SnakeMouthEatSprites.enteringCell.layer1},
+    {.fileName = "resources/snakeSprites/HeadEatEnterTop.png", .sprite = &SnakeMouthEatSprites.enteringCell.layer2},
+    {.fileName = "resources/snakeSprites/HeadOpenEnter.png", .sprite = &SnakeMouthOpenSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/HeadOpenLeave.png", .sprite = &SnakeMouthOpenSprites.leavingCell.main},
+    {.fileName = "resources/snakeSprites/HeadOpenLeaveLeft.png", .sprite = &SnakeMouthOpenSprites.leavingCell.left},
+    {.fileName = "resources/snakeSprites/HeadOpenLeaveRight.png", .sprite = &SnakeMouthOpenSprites.leavingCell.right},
+    {.fileName = "resources/snakeSprites/BodyEnter.png", .sprite = &SnakeBodySprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/BodyEnterLeft.png", .sprite = &SnakeBodySprites.enteringCell.left},
+    {.fileName = "resources/snakeSprites/BodyEnterRight.png", .sprite = &SnakeBodySprites.enteringCell.right},
+    {.fileName = "resources/snakeSprites/BodyLeave.png", .sprite = &SnakeBodySprites.leavingCell.main},
+    {.fileName = "resources/snakeSprites/BodyLeaveLeft.png", .sprite = &SnakeBodySprites.leavingCell.left},
+    {.fileName = "resources/snakeSprites/BodyLeaveRight.png", .sprite = &SnakeBodySprites.leavingCell.right},
+    {.fileName = "resources/snakeSprites/TailEnter.png", .sprite = &SnakeTailSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/TailEnterLeft.png", .sprite = &SnakeTailSprites.enteringCell.left},
+    {.fileName = "resources/snakeSprites/TailEnterRight.png", .sprite = &SnakeTailSprites.enteringCell.right},
+    {.fileName = "resources/snakeSprites/TailLeave.png", .sprite = &SnakeTailSprites.leavingCell.main},
+    {.fileName = "resources/snakeSprites/TailLengthen.png", .sprite = &TailLengthenSprites.enteringCell.main},
+    {.fileName = "resources/snakeSprites/TailLengthenLeft.png", .sprite = &TailLengthenSprites.enteringCell.left},
+    {.fileName = "resources/snakeSprites/TailLengthenRight.png", .sprite = &TailLengthenSprites.enteringCell.right},
+    {.fileName = "resources/Food.png", .sprite = &FoodSprite},
+    {.fileName = "resources/Sounds/ButtonClick.wav", .sound = &ButtonClick},
+    {.fileName = "resources/Sounds/GameStart.wav", .sound = &StartGame},
+    {.fileName = "resources/Sounds/GameWin.wav", .sound = &WinGame},
+    {.fileName = "resources/Sounds/SwitchScreen.wav", .sound = &SwitchScreen},
+    {.fileName = "resources/Sounds/SnakeEat.wav", .sound = &SnakeEat},
+    {.fileName = "resources/Sounds/SnakeDeath.wav", .sound = &SnakeDeath},
+};
+#define ASSETCOUNT (int)(sizeof(assets) / sizeof(assets[0]))
+#define ASSETTHREADS 4         // Worker threads decoding assets (the main thread also decodes while it has nothing else to do)
+#define ASSETFRAMEBUDGET 0.004 // Most time in seconds spent creating textures and sounds between two frames while they stream in
+
+atomic_int nextAssetToDecode; // Index of the next asset a thread can claim
+pthread_t assetThreads[ASSETTHREADS];
+int assetThreadCount = 0; // Asset threads that were started
+Bundle *assetBundle = NULL; // Mapped asset bundle (NULL if there isnt one, only kept open until everything has been uploaded)
+int assetsLoaded = 0;       // Assets whose texture or sound has been created
+bool assetsReady = false;   // Every asset is loaded so a game can be started
+
+// Times that parts of starting the game finished at (printed once every asset is loaded)
+typedef struct
+{
+    double start;       // Game started running
+    double window;      // Window and graphics context created
+    double firstFrame;  // First frame (the start menu) drawn
+    double audio;       // Audio device started (after the first frame)
+    double interactive; // Every sprite and sound loaded so a game can start without waiting
+    double blockedFrom; // Time a game was started before the assets were loaded (0 if they were ready in time)
+    bool printed;
+} StartupTimes;
+
+StartupTimes startupTimes;
+
+// How often frames are drawn and the CPU time spent in each state (printed when the game closes)
+typedef struct
+{
+    bool waitingForEvents;             // Frames are only drawn when there is input (static screens)
+    int fps;                           // Current target frame rate
+    double lastInput;                  // Time of the last input (a paused game stays at the full frame rate for a moment after it)
+    double cpuTime[PACINGSTATES];      // CPU seconds used by the whole game while in each state (can be more than the wall time with threads)
+    double wallTime[PACINGSTATES];     // Seconds spent in each state
+    double lastCpu;                    // CPU and wall time when the last frame was recorded
+    double lastWall;
+} FramePacing;
+
+FramePacing pacing = {.fps = FULLFPS};
+
 // Board cell
 typedef struct
 {
-    int contents;                    // Contents of a cell in the board (EMPTY, WALL, SNAKE...)
+    int contents;                    // Contents of a cell in the board (EMPTY, WALL, SNAKE...) read through 'cellContents'
+    unsigned generation;             // Board generation 'contents' was set in (contents from an earlier game are treated as empty)
     Position index;                  // Index in the 2d array 'board'
-    Texture2D spriteEnteringCell;    // Holdes the sprite animation entering the cell
-    Texture2D spriteLeavingCell;     // Holdes the sprite animation leaving the cell
+    Sprite spriteEnteringCell;       // Holdes the sprite animation entering the cell
+    Sprite spriteLeavingCell;        // Holdes the sprite animation leaving the cell
     int snakeSpriteDirection;        // Stores the direction of the sprite in this cell
     int snakeSpriteDirectionLeaving; // Stores the direction of the sprite leaving the cell (used when snakes head and tail are entering and leaving the same cell)
 
     bool multipleLayers; // For snake mouth eat and close
-    Texture2D layer1;    // Food layer (no rotation, only displayed while eating)
-    Texture2D layer2;    // Mouth top layer
+    Sprite layer1;       // Food layer (no rotation, only displayed while eating)
+    Sprite layer2;       // Mouth top layer
+    unsigned drawnFrame; // 'boardDrawCount' when the snake in this cell was last drawn (so a cell in the snake twice is only drawn once)
+    int quadSlot;        // Slot of the snake renderer holding the quads of this cell (only valid while the slot points back at the cell)
 } Cell;
 
+// Background of a square of cells (walls and the checkerboard) drawn once into a texture and reused every frame until it changes
+typedef struct
+{
+    RenderTexture2D texture;
+    int chunkX;        // Position of the chunk in chunks from the top left of the board
+    int chunkY;
+    int cellSize;      // Cell size the chunk was drawn at (0 if the slot is unused)
+    unsigned version;  // 'backgroundVersion' the chunk was drawn for
+    unsigned lastUsed; // 'boardDrawCount' the chunk was last on screen (the least recently used slot is reused)
+} BoardChunk;
+
+BoardChunk chunkCache[CHUNKCACHESIZE];
+
+// Whole board as one texture with a texel for each cell coloured by its contents (drawn when the cells are too small for sprites)
+// Cells mark their row when they change and only the marked rows are uploaded again the next time the overview is drawn
+typedef struct
+{
+    Texture2D texture;   // One texel per cell (id is 0 until the board is first zoomed out that far)
+    Color *pixels;       // Colour of every cell (row y starts at y * boardSize like the rows of the texture)
+    uint64_t *dirtyRows; // Bit y is set when row y has changed since it was last uploaded
+    int capacity;        // Cells allocated for in 'pixels'
+} BoardOverview;
+
+BoardOverview overview;
+
+// Whole board shrunk into a small texture for the corner of the screen, each texel shows the most important contents of its block of cells
+// Texels are updated as cells change (front entering, tail leaving, food placed) so drawing it doesnt depend on the size of the board
+typedef struct
+{
+    Texture2D texture;                         // 'size' by 'size' texels (id is 0 until the minimap is first shown)
+    Color pixels[MINIMAPSIZE * MINIMAPSIZE];   // Colour of every texel (row y starts at y * size)
+    int snakeCells[MINIMAPSIZE * MINIMAPSIZE]; // Cells of the snake in the block of each texel
+    int cellsPerTexel;                         // Width and height of the block of cells each texel covers
+    int size;                                  // Texels along each side
+    int dirtyTexels[MINIMAPDIRTYSIZE];         // Texels changed since the last upload (can be repeated)
+    int dirtyCount;                            // Number of texels in 'dirtyTexels'
+    bool rebuild;                              // Every texel needs rebuilding from the occupancy bitboard (new board, new game or loaded snapshot)
+} Minimap;
+
+Minimap minimap = {.rebuild = true};
+
+// What the quads in a slot of the snake renderer were last written for
+typedef struct
+{
+    Cell *cell;                        // Cell that owns the slot (NULL if the slot is free)
+    Position index;                    // Board index of the cell
+    int sprites[SNAKEQUADLAYERS];      // Atlas row of each layer (-1 if the layer isnt drawn)
+    int directions[SNAKEQUADLAYERS];   // Direction each layer is rotated to
+    unsigned drawnFrame;               // 'boardDrawCount' the cell was last found in the snake (the slot is freed once it isnt)
+} SnakeQuadSlot;
+
+// Keeps a quad for every sprite of the snake in a GPU vertex buffer so the whole snake is drawn with one call
+// Each snake cell owns a slot of quads that is only rewritten when the sprites of the cell change. The animation frame is a shader
+// uniform and the camera is the draw transform so neither of them rewrites any quads
+typedef struct
+{
+    Mesh mesh;                              // Vertices of every slot (positions in cells, texture coordinates in the atlas with x inside one frame)
+    Material material;                      // Snake shader, the sprite atlas (palette indices) and the palette (a row of colours for each skin)
+    int frameLocation;                      // Location of the 'frame' uniform
+    int skinLocation;                       // Location of the 'skinRow' uniform
+    Shader paletteShader;                   // Colours sprites and board chunks drawn one at a time from the palette
+    int paletteLocation;                    // Locations of the palette texture and 'skinRow' in the palette shader
+    int paletteSkinLocation;
+    SnakeQuadSlot slots[SNAKEQUADCAPACITY];
+    int freeSlots[SNAKEQUADCAPACITY];       // Slots that were given back (reused before any new slots)
+    int freeCount;
+    int slotCount;                          // Slots handed out so far (only these are drawn)
+    Mesh particleMesh;                      // Quads of the live particles (positions rewritten every frame, texture coordinates when a slot gets a new particle)
+    bool ready;                             // Atlas, palette, shaders and vertex buffer are loaded (otherwise sprites are drawn one at a time from their own textures)
+} SnakeRenderer;
+
+SnakeRenderer snakeRenderer;
+
+// Fixed size pool of particles stored as one array for each field so the update works through them 8 at a time
+// Dead particles are replaced by the last live particle so the live ones are always the first 'count'
+typedef struct
+{
+    float *x;              // Centre in cells from the top left of the board
+    float *y;
+    float *vx;             // Velocity in cells per second
+    float *vy;
+    float *life;           // Seconds left to live
+    float *shrink;         // Size in cells for each second of life left (particles shrink away to nothing)
+    unsigned char *sprite; // PARTICLEFOOD or PARTICLEBODY
+    unsigned char *frame;  // Frame of the sprite
+    int count;             // Live particles
+    int dirtyFrom;         // First slot given a different particle since the texture coordinates were last uploaded
+    uint64_t rng;          // Random state (separate from 'rngState' so effects dont change where food is placed)
+    int benchmarkCount;    // Particles kept alive while playing with '--particles' (0 when not benchmarking)
+    double updateTime;     // Seconds spent updating and drawing particles, and how many particles were updated and drawn (for the cost of each one)
+    double drawTime;
+    double updated;
+    double drawn;
+    int drawCalls;
+} ParticlePool;
+
+ParticlePool particles = {.dirtyFrom = PARTICLECAPACITY, .rng = 0x2545F4914F6CDD1Dull};
+
+// Text drawn once into a texture and copied to the screen every frame until it changes
+typedef struct
+{
+    RenderTexture2D texture; // Text drawn with the default font (id is 0 until the text is first shown)
+    long long key;           // Value the text was made from (the text is only formatted and drawn again when this changes)
+    int width;               // Size of the text in pixels
+    int height;
+} CachedText;
+
+CachedText hudText[HUDTEXTCOUNT];
+Image spriteAtlasImage; // Sprites copied into one image of palette indices as they are uploaded (uploaded as the atlas once every sprite is loaded)
+int spriteAtlasRows = 0;
+
+// Snake shaders (the frame of a sprite is picked with the 'frame' uniform so the quads dont change as the sprites animate)
+// The fragment shader is also used with raylibs default vertex shader to draw single sprites and board chunks
+const char *snakeVertexShader = "#version 330\n"
+                                "in vec3 vertexPosition;\n"
+                                "in vec2 vertexTexCoord;\n"
+                                "uniform mat4 mvp;\n"
+                                "uniform float frame;\n"
+                                "out vec2 fragTexCoord;\n"
+                                "void main()\n"
+                                "{\n"
+                                "    fragTexCoord = vec2((vertexTexCoord.x + frame) / 10.0, vertexTexCoord.y);\n" // Snake frames are a tenth of the atlas wide
+                                "    gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+                                "}\n";
+const char *snakeFragmentShader = "#version 330\n"
+                                  "in vec2 fragTexCoord;\n"
+                                  "uniform sampler2D texture0;\n" // Palette indices
+                                  "uniform sampler2D texture1;\n" // Palette (a row of 256 colours for each skin)
+                                  "uniform float skinRow;\n"      // Texture coordinate of the row of the current skin
+                                  "uniform vec4 colDiffuse;\n"
+                                  "out vec4 finalColor;\n"
+                                  "void main()\n"
+                                  "{\n"
+                                  "    float index = floor(texture(texture0, fragTexCoord).r * 255.0 + 0.5);\n"
+                                  "    finalColor = texture(texture1, vec2((index + 0.5) / 256.0, skinRow)) * colDiffuse;\n"
+                                  "}\n";
+
+// Block of memory allocated once when the game starts (sized for the biggest board) that all per-session buffers are carved from
+// Memory is never given back to it until the game closes so nothing is allocated while playing or starting a new game
+typedef struct
+{
+    char *base;  // Start of the block
+    size_t size; // Bytes in the block
+    size_t used; // Bytes carved off so far
+} Arena;
+
+Arena sessionArena;
+atomic_ullong heapAllocationCount = 0;      // Heap allocations counted so far (should stay the same from frame to frame once the game is running)
+uint64_t checkedAllocationCount = 0;        // 'heapAllocationCount' the last time it was checked at the end of a frame
+void (*allocationHook)(size_t size) = NULL; // Called with the size of every heap allocation (set to find where they come from, it must not allocate itself)
+
+void countHeapAllocation(size_t size)
+{
+    atomic_fetch_add_explicit(&heapAllocationCount, 1, memory_order_relaxed);
+    if (allocationHook != NULL)
+        allocationHook(size);
+}
+#if defined(COUNTALLOCATIONS) && defined(__GLIBC__)
+#define ALLOCATORREPLACED
+// Allocation checks (tests/snakealloctest.c) replace malloc, calloc and realloc for the whole program so every allocation is counted,
+// then handed on to the allocator of the C library. Normal builds only count the arena falling back to the heap as raylib and the
+// graphics driver allocate in ways the game doesnt control
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *block, size_t size);
+void *malloc(size_t size)
+{
+    countHeapAllocation(size);
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size)
+{
+    countHeapAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+void *realloc(void *block, size_t size)
+{
+    countHeapAllocation(size);
+    return __libc_realloc(block, size);
+}
+#endif
+
+// Occupancy bitboard of the board (one bit per cell) kept in sync with the 'contents' of each cell
+// Rows are stored along the y index and each row is packed into 64 bit words with bit x representing board[x][y]
+typedef struct
+{
+    int wordsPerRow;   // Number of words used to store one row of the board
+    int wordCount;     // Number of words in one layer (boardSize * wordsPerRow)
+    int capacity;      // Number of words allocated for each layer (so smaller boards can reuse the same memory)
+    uint64_t *body;    // Cells containing part of the snake
+    uint64_t *walls;   // Cells containing a board wall
+    uint64_t *food;    // Cells containing food
+    uint64_t *storage; // Single allocation holding all three layers (so the bitboard can be copied with one memcpy)
+} Bitboard;
+
+Bitboard occupancy; // Occupancy of the board used for collision, food adjacency and reachable area checks
+
+typedef struct
+{
+    int distance; // Tentative distance of the cell to the food
+    int cell;     // Index of the cell (y * boardSize + x)
+} DistanceSeed;
+
+// Distance from every cell to the food (walking only through free cells) used by the autopilot to choose its moves
+// Kept up to date as the snake moves instead of being rebuilt every move (only rebuilt when new food is placed)
+typedef struct
+{
+    int *distance;          // Distance to the food for every cell (UNREACHABLE if the food cant be reached)
+    int *queue;             // Queue of cell indexes for the breadth first searches
+    int *affectedList;      // Cells that lost their shortest path after a cell was blocked
+    DistanceSeed *seeds;    // Affected cells with a new tentative distance, sorted before being spread across the affected cells
+    unsigned char *state;   // QUEUED or AFFECTED state of each cell while repairing the field (0 otherwise)
+    int capacity;           // Number of cells allocated for
+    bool dirty;             // Set when the field needs to be rebuilt from scratch (new food or new board)
+} DistanceField;
+
+DistanceField foodDistance;
+Position foodPosition; // Position of the food currently on the board
+
+// Scratch bitboard layers for flood filling the board (same layout as the occupancy bitboard)
+typedef struct
+{
+    uint64_t *region; // Cells the fill has reached
+    uint64_t *open;   // Cells the fill can spread into
+    int capacity;     // Number of words allocated for each layer
+} RegionFill;
+
+// Result of flood filling the free cells connected to a cell
+typedef struct
+{
+    int size;         // Number of cells in the region (including the tail if it was reached)
+    bool reachesTail; // The region touches the tail so the snake can follow its tail out of it
+    bool reachesFood; // The region contains the food
+} RegionInfo;
+
+RegionFill regionFill;
+int cpuHasAVX2 = -1; // Set the first time it is needed by 'detectAVX2' (-1 until then)
+
+// Cycle that visits every playable cell once before returning to the start
+typedef struct
+{
+    int boardSize; // Board size (including walls) the cycle was built for (0 if the cache slot is unused)
+    int *order;    // Position of every cell along the cycle (indexed by y * boardSize + x, -1 for walls)
+} HamiltonianCycle;
+
+HamiltonianCycle cycleCache[CYCLECACHESIZE]; // Cycles are kept for each board size so switching difficulty doesnt rebuild them
+int nextCycleCacheSlot = 0;                  // Slot replaced when every slot in the cache is in use
+
 // Head of the snake is not displayed but is set based on the users input and guides the snake where to go when it makes its next move
 typedef struct
 {
@@ -122,8 +611,34 @@ typedef struct
     SnakeHead head;       // Head which is invisible and controls where the front of the snake will go when it moves
     int tailIndex;        // Keep track of the tail so it can be deleted when the snake moves. Extended when the snake eats to lengthen the snake
     Cell **snakeSegments; // List of pointers to board cells that make up all the parts of the snake (Head, front and body)
+    int segmentCapacity;  // Number of segments allocated (kept between games so starting a game doesnt allocate)
 } Snake;
 
+// Start of a game snapshot, followed by the bitboard layers and then one SnapshotSegment for each snake segment
+typedef struct
+{
+    int boardSize;
+    int tailIndex;
+    SnakeHead head;
+    int snakeMouthState;
+    int tailPointDirection;
+    int DeathType;
+    int gameState;
+    int scoreAchieved;
+    Position foodPosition;
+    uint64_t rngState;
+    uint64_t gameTick;
+    uint64_t positionHash;
+    int bitboardWords; // Number of words in each bitboard layer
+} SnapshotHeader;
+
+typedef struct
+{
+    int32_t cell;                       // Index of the board cell (x * boardSize + y) or -1 if the segment is empty
+    int8_t snakeSpriteDirection;        // Direction the snake entered the cell
+    int8_t snakeSpriteDirectionLeaving; // Direction the snake left the cell
+} SnapshotSegment;
+
 // Structure to hold relevent data and state of a button
 typedef struct
 {
@@ -133,6 +648,30 @@ typedef struct
     char *text;      // Contents of the button
 } Button;
 
+uint64_t gameRandom()
+{
+    // Returns the next random number (splitmix64) so the random state can be saved and restored with the rest of the game
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+uint64_t zobristKey(int cell, int contents)
+{
+    // Returns the random key for 'contents' being in 'cell' (y * boardSize + x) that is xored into 'positionHash'
+    // Keys are made by mixing the cell and contents (splitmix64 finaliser) so no table has to be built for each board size
+    if (contents != SNAKEBODY && contents != FOOD) // Empty cells and walls dont change during a game so arent part of the hash
+        return 0;
+    uint64_t z = ((uint64_t)cell << 2 | contents) * 0x9E3779B97F4A7C15ull + 0x2545F4914F6CDD1Dull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+uint64_t zobristDirectionKey(int Dir)
+{
+    // Returns the key for the snake moving in 'Dir' (cells past the end of the board so they dont clash with any cell key)
+    return zobristKey(boardSize * boardSize + Dir, SNAKEBODY);
+}
 Position findPos(Cell *itemRef)
 {
     // returns the x and y indexes of a cell
@@ -224,18 +763,595 @@ int numCellsToFill(Snake *snake, Cell board[boardSize][boardSize])
     int totalBoardCells = boardDimentions * boardDimentions; // Get how many cell need to be filled for a win (all cells)
     return totalBoardCells - (snake->tailIndex - 2);
 }
-bool isAdjacentToFood(Cell *cell, Cell board[boardSize][boardSize])
+size_t arenaBlockSize(size_t size)
+{
+    // Rounds an allocation up to a whole number of cache lines so buffers used by different parts of the game dont share a line
+    return (size + 63) & ~(size_t)63;
+}
+void *gameAlloc(size_t size)
+{
+    // Returns 'size' bytes of zeroed memory carved from the session arena
+    // Falls back to the heap (counting the allocation) if the arena is full so a wrong size estimate shows up instead of crashing
+    size = arenaBlockSize(size);
+    if (sessionArena.base != NULL && size <= sessionArena.size - sessionArena.used)
+    {
+        void *block = sessionArena.base + sessionArena.used;
+        sessionArena.used += size;
+        return block;
+    }
+#if !defined(ALLOCATORREPLACED)
+    countHeapAllocation(size); // Counted by the replaced allocator otherwise
+#endif
+    return calloc(1, size);
+}
+void gameFree(void *block)
+{
+    // Frees memory from 'gameAlloc' (memory carved from the arena is only given back when the arena is freed)
+    if ((char *)block >= sessionArena.base && (char *)block < sessionArena.base + sessionArena.size)
+        return;
+    free(block);
+}
+void checkAllocations()
+{
+    // Reports any allocations counted since the last check (called at the end of every frame once the game is running)
+    // Sprites and sounds allocate while they stream in so nothing is reported until they are all loaded
+    uint64_t count = atomic_load_explicit(&heapAllocationCount, memory_order_relaxed);
+    if (count != checkedAllocationCount && assetsReady)
+        printf("Warning: %llu heap allocations during the last frame\n", (unsigned long long)(count - checkedAllocationCount));
+    checkedAllocationCount = atomic_load_explicit(&heapAllocationCount, memory_order_relaxed); // Includes anything printing the warning allocated
+}
+void resizeBitboard(Bitboard *bits)
+{
+    // Sizes the bitboard for the current 'boardSize' and clears all layers (only allocates when the board is bigger than any board before it)
+    bits->wordsPerRow = (boardSize + 63) / 64;
+    bits->wordCount = boardSize * bits->wordsPerRow;
+    if (bits->wordCount > bits->capacity)
+    {
+        gameFree(bits->storage);
+        bits->storage = (uint64_t *)gameAlloc(3 * bits->wordCount * sizeof(uint64_t));
+        bits->capacity = bits->wordCount;
+    }
+    bits->body = bits->storage;
+    bits->walls = bits->storage + bits->wordCount;
+    bits->food = bits->storage + 2 * bits->wordCount;
+    memset(bits->storage, 0, 3 * bits->wordCount * sizeof(uint64_t));
+}
+void copyBitboard(Bitboard *dest, const Bitboard *src)
+{
+    // Copies the layers of 'src' into 'dest' (used by searches to work on a copy of the board)
+    if (dest->capacity < src->wordCount)
+    {
+        gameFree(dest->storage);
+        dest->storage = (uint64_t *)gameAlloc(3 * src->wordCount * sizeof(uint64_t));
+        dest->capacity = src->wordCount;
+    }
+    dest->wordsPerRow = src->wordsPerRow;
+    dest->wordCount = src->wordCount;
+    dest->body = dest->storage;
+    dest->walls = dest->storage + dest->wordCount;
+    dest->food = dest->storage + 2 * dest->wordCount;
+    memcpy(dest->storage, src->storage, 3 * src->wordCount * sizeof(uint64_t));
+}
+void freeBitboard(Bitboard *bits)
+{
+    gameFree(bits->storage);
+    bits->storage = NULL;
+    bits->capacity = 0;
+}
+void resizeOverview()
+{
+    // Sizes the board overview for the current 'boardSize' and marks every row to be rebuilt
+    if (boardSize * boardSize > overview.capacity)
+    {
+        gameFree(overview.pixels);
+        gameFree(overview.dirtyRows);
+        overview.pixels = (Color *)gameAlloc(boardSize * boardSize * sizeof(Color));
+        overview.dirtyRows = (uint64_t *)gameAlloc((boardSize + 63) / 64 * sizeof(uint64_t));
+        overview.capacity = boardSize * boardSize;
+    }
+    memset(overview.dirtyRows, 0xff, (boardSize + 63) / 64 * sizeof(uint64_t));
+}
+uint64_t bitboardRowBits(const uint64_t *layer, int x, int y)
+{
+    // Returns the 64 bits of row 'y' starting at column 'x' (bit 0 of the result is cell x, bit 1 is cell x + 1...)
+    const uint64_t *row = layer + y * occupancy.wordsPerRow;
+    int word = x / 64;
+    int shift = x % 64;
+    uint64_t bits = row[word] >> shift;
+    if (shift != 0 && word + 1 < occupancy.wordsPerRow)
+        bits |= row[word + 1] << (64 - shift); // Bring in the bits from the next word of the row
+    return bits;
+}
+bool bitboardTest(const uint64_t *layer, Position pos)
+{
+    // Returns true if the bit for the cell at 'pos' is set
+    return (layer[pos.y * occupancy.wordsPerRow + pos.x / 64] >> (pos.x % 64)) & 1;
+}
+bool isCellBlocked(Position pos)
+{
+    // Returns true if the cell contains a wall or part of the snake
+    int word = pos.y * occupancy.wordsPerRow + pos.x / 64;
+    return ((occupancy.body[word] | occupancy.walls[word]) >> (pos.x % 64)) & 1;
+}
+bool isCellIndexBlocked(int cell)
+{
+    // Same as 'isCellBlocked' but using the index of the cell in the distance field
+    return isCellBlocked((Position){cell % boardSize, cell / boardSize});
+}
+int compareDistanceSeeds(const void *a, const void *b)
+{
+    return ((const DistanceSeed *)a)->distance - ((const DistanceSeed *)b)->distance;
+}
+void resizeDistanceField(DistanceField *field)
+{
+    // Makes sure there is space for every cell on the current board and marks the field to be rebuilt
+    int cellCount = boardSize * boardSize;
+    if (cellCount > field->capacity)
+    {
+        gameFree(field->distance);
+        gameFree(field->queue);
+        gameFree(field->affectedList);
+        gameFree(field->seeds);
+        gameFree(field->state);
+        field->distance = (int *)gameAlloc(cellCount * sizeof(int));
+        field->queue = (int *)gameAlloc(cellCount * sizeof(int));
+        field->affectedList = (int *)gameAlloc(cellCount * sizeof(int));
+        field->seeds = (DistanceSeed *)gameAlloc(cellCount * sizeof(DistanceSeed));
+        field->state = (unsigned char *)gameAlloc(cellCount * sizeof(unsigned char));
+        field->capacity = cellCount;
+    }
+    field->dirty = true;
+}
+void freeDistanceField(DistanceField *field)
+{
+    gameFree(field->distance);
+    gameFree(field->queue);
+    gameFree(field->affectedList);
+    gameFree(field->seeds);
+    gameFree(field->state);
+    *field = (DistanceField){0};
+}
+void resetAutopilotStats()
+{
+    autopilotTime = 0.0;
+    autopilotMoveCount = 0;
+    autopilotStartTime = GetTime();
+    mctsRollouts = 0;
+    mctsSearchTime = 0.0;
+    if (mctsBot != NULL) // Stop searching in the background if the Monte Carlo autopilot has been switched off
+        mcts_stop(mctsBot, NULL);
+    foodDistance.dirty = true; // The field isnt kept up to date while the pathfinder isnt being used
+}
+void rebuildDistanceField(DistanceField *field)
+{
+    // Breadth first search out from the food over every free cell
+    int cellCount = boardSize * boardSize;
+    const int offsets[4] = {-boardSize, boardSize, -1, 1}; // Cells above, below, left and right (walls stop the search leaving the board)
+    for (int i = 0; i < cellCount; i++)
+        field->distance[i] = UNREACHABLE;
+
+    int foodCell = foodPosition.y * boardSize + foodPosition.x;
+    field->distance[foodCell] = 0;
+    field->queue[0] = foodCell;
+    int head = 0, tail = 1;
+    while (head < tail)
+    {
+        int cell = field->queue[head++];
+        for (int i = 0; i < 4; i++)
+        {
+            int next = cell + offsets[i];
+            if (field->distance[next] == UNREACHABLE && !isCellIndexBlocked(next))
+            {
+                field->distance[next] = field->distance[cell] + 1;
+                field->queue[tail++] = next;
+            }
+        }
+    }
+    field->dirty = false;
+}
+void spreadDistances(DistanceField *field, int seedCount)
+{
+    // Breadth first search starting from several cells with different distances
+    // Seeds are merged into the queue in distance order so every cell is only given its final distance once
+    const int offsets[4] = {-boardSize, boardSize, -1, 1};
+    int head = 0, tail = 0, seed = 0;
+    while (seed < seedCount || head < tail)
+    {
+        int cell;
+        if (head < tail && (seed >= seedCount || field->distance[field->queue[head]] <= field->seeds[seed].distance))
+            cell = field->queue[head++];
+        else
+        {
+            cell = field->seeds[seed].cell;
+            if (field->distance[cell] != field->seeds[seed++].distance)
+                continue; // Seed has already been reached with a shorter distance
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            int next = cell + offsets[i];
+            if (field->distance[cell] + 1 < field->distance[next] && !isCellIndexBlocked(next))
+            {
+                field->distance[next] = field->distance[cell] + 1;
+                field->queue[tail++] = next;
+            }
+        }
+    }
+}
+void distanceFieldUnblock(DistanceField *field, Position pos)
+{
+    // A cell has been freed (the tail has left it) so distances around it can only get shorter
+    const int offsets[4] = {-boardSize, boardSize, -1, 1};
+    int cell = pos.y * boardSize + pos.x;
+    int distance = UNREACHABLE;
+    for (int i = 0; i < 4; i++)
+    {
+        int next = cell + offsets[i];
+        if (!isCellIndexBlocked(next) && field->distance[next] + 1 < distance)
+            distance = field->distance[next] + 1;
+    }
+    field->distance[cell] = distance;
+    if (distance == UNREACHABLE)
+        return;
+
+    field->seeds[0] = (DistanceSeed){distance, cell};
+    spreadDistances(field, 1);
+}
+void distanceFieldBlock(DistanceField *field, Position pos)
+{
+    // A cell has been filled (the snakes front has entered it) so cells whose shortest paths all went through it need new distances
+    const int offsets[4] = {-boardSize, boardSize, -1, 1};
+    int cell = pos.y * boardSize + pos.x;
+    int blockedDistance = field->distance[cell];
+    field->distance[cell] = UNREACHABLE;
+    if (blockedDistance == UNREACHABLE)
+        return;
+
+    // Find the affected cells in distance order (a cell is affected if none of its neighbours one step closer to the food are still unaffected)
+    int head = 0, tail = 0, affectedCount = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int next = cell + offsets[i];
+        if (field->distance[next] == blockedDistance + 1 && !isCellIndexBlocked(next) && field->state[next] == 0)
+        {
+            field->state[next] = QUEUED;
+            field->queue[tail++] = next;
+        }
+    }
+    while (head < tail)
+    {
+        int current = field->queue[head++];
+        bool supported = false;
+        for (int i = 0; i < 4 && !supported; i++)
+        {
+            int next = current + offsets[i];
+            supported = field->distance[next] == field->distance[current] - 1 && field->state[next] != AFFECTED && !isCellIndexBlocked(next);
+        }
+        if (supported)
+            continue;
+
+        field->state[current] = AFFECTED;
+        field->affectedList[affectedCount++] = current;
+        for (int i = 0; i < 4; i++)
+        {
+            int next = current + offsets[i];
+            if (field->distance[next] == field->distance[current] + 1 && field->state[next] == 0 && !isCellIndexBlocked(next))
+            {
+                field->state[next] = QUEUED;
+                field->queue[tail++] = next;
+            }
+        }
+    }
+
+    // Give each affected cell the best distance it can get from its unaffected neighbours
+    for (int i = 0; i < affectedCount; i++)
+        field->distance[field->affectedList[i]] = UNREACHABLE;
+    int seedCount = 0;
+    for (int i = 0; i < affectedCount; i++)
+    {
+        int current = field->affectedList[i];
+        int distance = UNREACHABLE;
+        for (int j = 0; j < 4; j++)
+        {
+            int next = current + offsets[j];
+            if (field->state[next] != AFFECTED && !isCellIndexBlocked(next) && field->distance[next] + 1 < distance)
+                distance = field->distance[next] + 1;
+        }
+        if (distance != UNREACHABLE)
+            field->seeds[seedCount++] = (DistanceSeed){distance, current};
+    }
+    for (int i = 0; i < tail; i++)
+        field->state[field->queue[i]] = 0; // Clear the states for the next update
+
+    // Spread the new distances out over the affected cells
+    qsort(field->seeds, seedCount, sizeof(DistanceSeed), compareDistanceSeeds);
+    for (int i = 0; i < seedCount; i++)
+        field->distance[field->seeds[i].cell] = field->seeds[i].distance;
+    spreadDistances(field, seedCount);
+}
+void updateDistanceField(Position pos, int previousContents, int contents)
+{
+    // Keeps the autopilots distance field in step with a change to a cell on the board
+    bool wasBlocked = previousContents == SNAKEBODY || previousContents == BOARDWALL;
+    bool blocked = contents == SNAKEBODY || contents == BOARDWALL;
+
+    if (!(autopilotMode == PATHFINDER) || contents == FOOD || previousContents == FOOD)
+        foodDistance.dirty = true; // Food has moved (or the field isnt being used) so the field is rebuilt when it is next needed
+    if (foodDistance.dirty)
+        return;
+
+    double startTime = GetTime();
+    if (blocked && !wasBlocked)
+        distanceFieldBlock(&foodDistance, pos);
+    else if (wasBlocked && !blocked)
+        distanceFieldUnblock(&foodDistance, pos);
+    autopilotTime += GetTime() - startTime; // Updates are part of the autopilots cost for each move
+}
+void minimapCellChanged(Position pos, int previousContents, int contents)
+{
+    // Updates the snake count of the texel covering 'pos' and marks it to be uploaded again
+    if (minimap.rebuild) // Counts are all worked out again when the minimap is rebuilt
+        return;
+    int texel = pos.y / minimap.cellsPerTexel * minimap.size + pos.x / minimap.cellsPerTexel;
+    if (previousContents == SNAKEBODY)
+        minimap.snakeCells[texel]--;
+    if (contents == SNAKEBODY)
+        minimap.snakeCells[texel]++;
+    if (minimap.dirtyCount == MINIMAPDIRTYSIZE)
+        minimap.rebuild = true;
+    else
+        minimap.dirtyTexels[minimap.dirtyCount++] = texel;
+}
+int cellContents(const Cell *cell)
+{
+    // Returns the contents of a cell, anything but a wall set in an earlier generation of the board is empty
+    // (walls stay where they are between games on the same size board)
+    if (cell->generation != boardGeneration && cell->contents != BOARDWALL)
+        return EMPTY;
+    return cell->contents;
+}
+void setCellContents(Cell *cell, int contents)
+{
+    // Sets the contents of a board cell and updates the occupancy bitboard to match
+    int previousContents = cellContents(cell);
+    cell->generation = boardGeneration;
+    int word = cell->index.y * occupancy.wordsPerRow + cell->index.x / 64;
+    uint64_t bit = (uint64_t)1 << (cell->index.x % 64);
+
+    cell->contents = contents;
+    occupancy.body[word] &= ~bit;
+    occupancy.walls[word] &= ~bit;
+    occupancy.food[word] &= ~bit;
+    if (contents == SNAKEBODY)
+        occupancy.body[word] |= bit;
+    else if (contents == BOARDWALL)
+        occupancy.walls[word] |= bit;
+    else if (contents == FOOD)
+        occupancy.food[word] |= bit;
+
+    if (contents == FOOD)
+        foodPosition = cell->index;
+    if (previousContents != contents)
+    {
+        overview.dirtyRows[cell->index.y / 64] |= (uint64_t)1 << (cell->index.y % 64);
+        minimapCellChanged(cell->index, previousContents, contents);
+        int cellIndex = cell->index.y * boardSize + cell->index.x;
+        positionHash ^= zobristKey(cellIndex, previousContents) ^ zobristKey(cellIndex, contents);
+        updateDistanceField(cell->index, previousContents, contents);
+    }
+}
+bool isAdjacentToFood(Cell *cell)
 {
     // Returns true if the snakes front is in a cell that is directly (not diagonally) adjecent to a cell containing food
-    if (board[cell->index.x + 1][cell->index.y].contents == FOOD)
-        return true;
-    if (board[cell->index.x - 1][cell->index.y].contents == FOOD)
-        return true;
-    if (board[cell->index.x][cell->index.y + 1].contents == FOOD)
-        return true;
-    if (board[cell->index.x][cell->index.y - 1].contents == FOOD)
-        return true;
-    return false;
+    int x = cell->index.x;
+    int y = cell->index.y;
+    if (bitboardTest(occupancy.walls, cell->index)) // Snake has just hit a wall (the cells around it may be off the board)
+        return false;
+    uint64_t adjacentFood = bitboardRowBits(occupancy.food, x - 1, y) & 0x5; // Cells to the left and right (bits 0 and 2 of the row starting one cell to the left)
+    adjacentFood |= bitboardRowBits(occupancy.food, x, y - 1) & 0x1;         // Cell above
+    adjacentFood |= bitboardRowBits(occupancy.food, x, y + 1) & 0x1;         // Cell below
+    return adjacentFood != 0;
+}
+uint64_t fillRowWord(uint64_t bits, uint64_t open)
+{
+    // Spreads 'bits' left and right through the runs of set bits in 'open' (Kogge-Stone fill, 6 steps each way written out
+    // so the two directions run side by side)
+    uint64_t left = bits, right = bits, leftOpen = open, rightOpen = open;
+    left |= leftOpen & (left << 1), right |= rightOpen & (right >> 1);
+    leftOpen &= leftOpen << 1, rightOpen &= rightOpen >> 1;
+    left |= leftOpen & (left << 2), right |= rightOpen & (right >> 2);
+    leftOpen &= leftOpen << 2, rightOpen &= rightOpen >> 2;
+    left |= leftOpen & (left << 4), right |= rightOpen & (right >> 4);
+    leftOpen &= leftOpen << 4, rightOpen &= rightOpen >> 4;
+    left |= leftOpen & (left << 8), right |= rightOpen & (right >> 8);
+    leftOpen &= leftOpen << 8, rightOpen &= rightOpen >> 8;
+    left |= leftOpen & (left << 16), right |= rightOpen & (right >> 16);
+    leftOpen &= leftOpen << 16, rightOpen &= rightOpen >> 16;
+    left |= leftOpen & (left << 32), right |= rightOpen & (right >> 32);
+    return (left | right) & open;
+}
+bool spreadRowWords(int y, int firstWord, int lastWord)
+{
+    // Spreads the region into row 'y' from the rows above and below it and along the row for words 'firstWord' to 'lastWord'
+    // Returns true if any cell was added
+    int wordsPerRow = occupancy.wordsPerRow;
+    uint64_t *row = regionFill.region + y * wordsPerRow;
+    const uint64_t *open = regionFill.open + y * wordsPerRow;
+    uint64_t added = 0;
+    for (int w = firstWord; w <= lastWord; w++)
+    {
+        uint64_t bits = row[w] | (open[w] & (row[w - wordsPerRow] | row[w + wordsPerRow]));
+        if (bits == row[w]) // Nothing new from the rows above and below (the row has already been filled along)
+            continue;
+        bits = fillRowWord(bits, open[w]);
+        added |= bits ^ row[w];
+        row[w] = bits;
+    }
+    return added != 0;
+}
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) bool spreadRowWordsAVX2(int y, int firstWord, int lastWord)
+{
+    // Same as 'spreadRowWords' but handles four words of the row at a time (used for boards wider than 256 cells)
+    int wordsPerRow = occupancy.wordsPerRow;
+    uint64_t *row = regionFill.region + y * wordsPerRow;
+    const uint64_t *open = regionFill.open + y * wordsPerRow;
+    __m256i added = _mm256_setzero_si256();
+    int w = firstWord;
+    for (; w + 3 <= lastWord; w += 4)
+    {
+        __m256i current = _mm256_loadu_si256((const __m256i *)(row + w));
+        __m256i openBits = _mm256_loadu_si256((const __m256i *)(open + w));
+        __m256i above = _mm256_loadu_si256((const __m256i *)(row + w - wordsPerRow));
+        __m256i below = _mm256_loadu_si256((const __m256i *)(row + w + wordsPerRow));
+        __m256i bits = _mm256_or_si256(current, _mm256_and_si256(openBits, _mm256_or_si256(above, below)));
+        __m256i newBits = _mm256_xor_si256(bits, current);
+        if (_mm256_testz_si256(newBits, newBits)) // Nothing new from the rows above and below
+            continue;
+        __m256i left = bits, right = bits, leftOpen = openBits, rightOpen = openBits;
+        for (int shift = 1; shift < 64; shift *= 2)
+        {
+            __m128i count = _mm_cvtsi32_si128(shift);
+            left = _mm256_or_si256(left, _mm256_and_si256(leftOpen, _mm256_sll_epi64(left, count)));
+            right = _mm256_or_si256(right, _mm256_and_si256(rightOpen, _mm256_srl_epi64(right, count)));
+            leftOpen = _mm256_and_si256(leftOpen, _mm256_sll_epi64(leftOpen, count));
+            rightOpen = _mm256_and_si256(rightOpen, _mm256_srl_epi64(rightOpen, count));
+        }
+        bits = _mm256_and_si256(_mm256_or_si256(left, right), openBits);
+        added = _mm256_or_si256(added, _mm256_xor_si256(bits, current));
+        _mm256_storeu_si256((__m256i *)(row + w), bits);
+    }
+    bool anyAdded = !_mm256_testz_si256(added, added);
+    if (w <= lastWord)
+        anyAdded |= spreadRowWords(y, w, lastWord);
+    return anyAdded;
+}
+#endif
+bool spreadRow(int y)
+{
+    // Spreads the region into row 'y' returning true if any cell was added
+    int wordsPerRow = occupancy.wordsPerRow;
+    if (wordsPerRow == 1) // Boards up to 64 cells wide have no boundaries between words to carry across
+        return spreadRowWords(y, 0, 0);
+    bool added;
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpuHasAVX2 && wordsPerRow >= 4)
+        added = spreadRowWordsAVX2(y, 0, wordsPerRow - 1);
+    else
+#endif
+        added = spreadRowWords(y, 0, wordsPerRow - 1);
+
+    // Carry the region across the boundaries between the words of the row (to the right and then to the left)
+    uint64_t *row = regionFill.region + y * wordsPerRow;
+    const uint64_t *open = regionFill.open + y * wordsPerRow;
+    for (int w = 1; w < wordsPerRow; w++)
+    {
+        if ((row[w - 1] >> 63) && (open[w] & 1) && !(row[w] & 1))
+        {
+            row[w] = fillRowWord(row[w] | 1, open[w]);
+            added = true;
+        }
+    }
+    for (int w = wordsPerRow - 2; w >= 0; w--)
+    {
+        if ((row[w + 1] & 1) && (open[w] >> 63) && !(row[w] >> 63))
+        {
+            row[w] = fillRowWord(row[w] | (uint64_t)1 << 63, open[w]);
+            added = true;
+        }
+    }
+    return added;
+}
+void resizeRegionFill()
+{
+    // Makes sure the flood fill layers have space for the occupancy bitboard
+    if (occupancy.wordCount > regionFill.capacity)
+    {
+        gameFree(regionFill.region);
+        regionFill.region = (uint64_t *)gameAlloc(2 * occupancy.wordCount * sizeof(uint64_t));
+        regionFill.open = regionFill.region + occupancy.wordCount;
+        regionFill.capacity = occupancy.wordCount;
+    }
+}
+void detectAVX2()
+{
+    if (cpuHasAVX2 != -1)
+        return;
+#if defined(__x86_64__) || defined(__i386__)
+    cpuHasAVX2 = __builtin_cpu_supports("avx2");
+#else
+    cpuHasAVX2 = 0;
+#endif
+}
+RegionInfo floodFillRegion(Position start, Position tail)
+{
+    // Finds the free cells connected to 'start' by sweeping down and up the board filling whole rows of cells at a time with bit operations
+    // The tail counts as free as it moves out of the way ('tail' can be {-1, -1} if it shouldnt be)
+    RegionInfo info = {0, false, false};
+    int wordsPerRow = occupancy.wordsPerRow;
+    detectAVX2();
+    resizeRegionFill();
+
+    // Cells the fill can spread into
+    for (int word = 0; word < occupancy.wordCount; word++)
+        regionFill.open[word] = ~(occupancy.body[word] | occupancy.walls[word]);
+    if (boardSize % 64 != 0) // Remove the bits past the end of each row
+    {
+        for (int y = 0; y < boardSize; y++)
+            regionFill.open[y * wordsPerRow + wordsPerRow - 1] &= ((uint64_t)1 << (boardSize % 64)) - 1;
+    }
+    if (tail.x >= 0)
+        regionFill.open[tail.y * wordsPerRow + tail.x / 64] |= (uint64_t)1 << (tail.x % 64);
+    if (!bitboardTest(regionFill.open, start))
+        return info;
+
+    memset(regionFill.region, 0, occupancy.wordCount * sizeof(uint64_t));
+    int startWord = start.y * wordsPerRow + start.x / 64;
+    regionFill.region[startWord] = fillRowWord((uint64_t)1 << (start.x % 64), regionFill.open[startWord]);
+    spreadRow(start.y); // Carries the start of the region into the other words of its row
+
+    // Sweep down and up over the rows the region could reach until a sweep adds nothing
+    // Only the rows between the top and bottom of the region (and one row either side) are visited
+    int top = start.y, bottom = start.y;
+    for (int sweep = 0;; sweep++)
+    {
+        bool added = false;
+        if (sweep % 2 == 0)
+        {
+            for (int y = top; y <= bottom + 1 && y < boardSize - 1; y++)
+            {
+                if (spreadRow(y))
+                {
+                    added = true;
+                    if (y > bottom)
+                        bottom = y;
+                }
+            }
+        }
+        else
+        {
+            for (int y = bottom; y >= top - 1 && y > 0; y--)
+            {
+                if (spreadRow(y))
+                {
+                    added = true;
+                    if (y < top)
+                        top = y;
+                }
+            }
+        }
+        if (!added && sweep > 0) // Every row has been checked against the rows next to it since they last changed
+            break;
+    }
+
+    for (int word = top * wordsPerRow; word < (bottom + 1) * wordsPerRow; word++)
+    {
+        info.size += __builtin_popcountll(regionFill.region[word]);
+        if (regionFill.region[word] & occupancy.food[word])
+            info.reachesFood = true;
+    }
+    info.reachesTail = tail.x >= 0 && bitboardTest(regionFill.region, tail);
+    return info;
 }
 bool isSameCell(Cell cell1, Cell cell2)
 {
@@ -328,10 +1444,83 @@ void SetLeavingSprite(SpriteCollection leaving, Snake *snake, int segmentIndx)
         snake->snakeSegments[segmentIndx]->spriteLeavingCell = leaving.leavingCell.right;
 }
 
-void DrawCenteredText(const char *text, int y, int fontSize, Color color, int screenWidth)
+void pushRenderTarget(RenderTexture2D *target)
+{
+    // Starts drawing into 'target' until 'popRenderTarget' (anything already drawn is flushed into the target underneath first)
+    renderTargets[renderTargetCount++] = target;
+    BeginTextureMode(*target);
+}
+void popRenderTarget()
+{
+    EndTextureMode();
+    renderTargetCount--;
+    if (renderTargetCount > 0)
+        BeginTextureMode(*renderTargets[renderTargetCount - 1]);
+}
+void resizeRenderTarget(RenderTexture2D *target, int width, int height)
+{
+    // Makes 'target' 'width' by 'height' pixels (only creates a new texture when the size changes)
+    if (target->id != 0 && target->texture.width == width && target->texture.height == height)
+        return;
+    if (target->id != 0)
+        UnloadRenderTexture(*target);
+    *target = LoadRenderTexture(width, height);
+}
+void presentScreen()
 {
-    int textWidth = MeasureText(text, fontSize);
-    DrawText(text, (screenWidth - textWidth) / 2, y, fontSize, color);
+    // Draws the frame to the window scaled up by the biggest whole number that fits (so pixels stay square and sharp) with black bars
+    // around it. The window is measured in real pixels so HiDPI screens get the full scale, smaller windows than the frame shrink it to fit
+    Vector2 dpi = GetWindowScaleDPI();
+    int renderWidth = GetRenderWidth();
+    int renderHeight = GetRenderHeight();
+    float scale = renderWidth / screenWidth < renderHeight / screenHeight ? renderWidth / screenWidth : renderHeight / screenHeight;
+    if (scale < 1.0f)
+        scale = (float)renderWidth / screenWidth < (float)renderHeight / screenHeight ? (float)renderWidth / screenWidth : (float)renderHeight / screenHeight;
+    int width = (int)(screenWidth * scale);
+    int height = (int)(screenHeight * scale);
+    Rectangle frame = {(renderWidth - width) / 2 / dpi.x, (renderHeight - height) / 2 / dpi.y, width / dpi.x, height / dpi.y}; // Window coordinates
+    ClearBackground(BLACK);
+    DrawTexturePro(screenTarget.texture, (Rectangle){0, 0, screenWidth, -screenHeight}, frame, (Vector2){0, 0}, 0.0f, WHITE); // Render textures are stored upside down
+
+    // Mouse positions are given in frame coordinates so buttons still line up
+    SetMouseOffset(-(int)frame.x, -(int)frame.y);
+    SetMouseScale(screenWidth / frame.width, screenHeight / frame.height);
+}
+void drawCachedText(int slot, long long key, int x, int y, int align, int fontSize, Color colour, const char *format, ...)
+{
+    // Draws the text made from 'format' from the texture of 'slot', the text is only formatted, measured and drawn into the texture
+    // when 'key' changes (the default font has no partly see-through pixels so it looks the same as text drawn straight to the screen)
+    CachedText *text = &hudText[slot];
+    if (text->texture.id == 0 || text->key != key)
+    {
+        char buffer[128];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        int lines = 1;
+        for (const char *c = buffer; *c != '\0'; c++)
+            lines += *c == '\n';
+        text->key = key;
+        text->width = MeasureText(buffer, fontSize);
+        text->height = fontSize + (lines - 1) * (fontSize + TEXTLINESPACING);
+        resizeRenderTarget(&text->texture, text->width > 0 ? text->width : 1, text->height);
+        pushRenderTarget(&text->texture);
+        ClearBackground(BLANK);
+        DrawText(buffer, 0, 0, fontSize, colour);
+        popRenderTarget();
+    }
+    if (align == TEXTCENTER)
+        x -= (text->width + 1) / 2; // Odd widths round the same way as centring the text on the screen
+    else if (align == TEXTRIGHT)
+        x -= text->width;
+    Rectangle source = {0, 0, text->texture.texture.width, -text->texture.texture.height}; // Render textures are stored upside down
+    DrawTextureRec(text->texture.texture, source, (Vector2){x, y}, WHITE);
+}
+void unloadHudText()
+{
+    for (int i = 0; i < HUDTEXTCOUNT; i++)
+        UnloadRenderTexture(hudText[i].texture);
 }
 void DrawButton(Button button)
 {
@@ -371,22 +1560,42 @@ void DrawButton(Button button)
     int textHeight = fontsize;
     DrawText(text, x + (width / 2) - (textWidth / 2), y + (height / 2) - (textHeight / 2), fontsize, textColour);
 }
-void AnimateSprite(int X, int Y, int cellSize, Texture2D snakeSprite, int spriteDirection, int spriteFrame)
+void usePaletteShader()
+{
+    // Colours the textures drawn after this from the palette of the current skin (until 'EndShaderMode')
+    BeginShaderMode(snakeRenderer.paletteShader); // Only does anything if another shader is in use
+    SetShaderValueTexture(snakeRenderer.paletteShader, snakeRenderer.paletteLocation, snakeRenderer.material.maps[MATERIAL_MAP_SPECULAR].texture); // raylib lets go of extra textures after every batch
+}
+void drawSpriteSection(Sprite sprite, Rectangle spriteSection, Rectangle drawLocation, Vector2 origin, float rotation)
 {
-    Rectangle spriteSection = {snakeSprite.width / 5 * spriteFrame, 0, snakeSprite.width / 5, snakeSprite.height}; // Selects the correct section from the texture (each snake sprite has 5 frames)
+    // Draws part of a sprite from the palette atlas once it is loaded (the sprites own texture has been unloaded by then)
+    int row = snakeRenderer.ready ? sprite.atlasRow : -1;
+    if (row == -1)
+    {
+        EndShaderMode(); // Sprites that arent in the atlas are already coloured
+        DrawTexturePro(sprite.texture, spriteSection, drawLocation, origin, rotation, WHITE);
+        return;
+    }
+    spriteSection.y += row * ATLASFRAMESIZE;
+    usePaletteShader();
+    DrawTexturePro(snakeRenderer.material.maps[MATERIAL_MAP_DIFFUSE].texture, spriteSection, drawLocation, origin, rotation, WHITE);
+}
+void AnimateSprite(int X, int Y, int cellSize, Sprite snakeSprite, int spriteDirection, int spriteFrame)
+{
+    Rectangle spriteSection = {snakeSprite.texture.width / 5 * spriteFrame, 0, snakeSprite.texture.width / 5, snakeSprite.texture.height}; // Selects the correct section from the texture (each snake sprite has 5 frames)
     Rectangle drawLocation = {X + (float)cellSize / 2, Y + (float)cellSize / 2, cellSize, cellSize};               // Chooses the center of the cell to draw the sprite section at
     Vector2 origin = {(float)cellSize / 2, (float)cellSize / 2};                                                   // Sets origin to center of the cell to allow rotation
     float rotation = spriteRoatationFromDirection(spriteDirection);                                                // Finds rotaion based on the direction the snake was facing when it went throught that cell
-    DrawTexturePro(snakeSprite, spriteSection, drawLocation, origin, rotation, WHITE);                             // Draw sprite
+    drawSpriteSection(snakeSprite, spriteSection, drawLocation, origin, rotation);                                 // Draw sprite
 }
-void AnimateLongSprite(int X, int Y, int cellSize, Texture2D snakeSprite, int spriteDirection, int spriteFrame)
+void AnimateLongSprite(int X, int Y, int cellSize, Sprite snakeSprite, int spriteDirection, int spriteFrame)
 {
     // Used to draw the 40x20 sprite used in snakes death animation when hitting a part of the snake
-    Rectangle spriteSection = {snakeSprite.width / 5 * spriteFrame, 0, snakeSprite.width / 5, snakeSprite.height};
+    Rectangle spriteSection = {snakeSprite.texture.width / 5 * spriteFrame, 0, snakeSprite.texture.width / 5, snakeSprite.texture.height};
     Rectangle drawLocation = {X + (float)cellSize / 2, Y + (float)cellSize / 2, cellSize * 2, cellSize};
     Vector2 origin = {(float)cellSize * 1.5f, (float)cellSize / 2};
     float rotation = spriteRoatationFromDirection(spriteDirection);
-    DrawTexturePro(snakeSprite, spriteSection, drawLocation, origin, rotation, WHITE);
+    drawSpriteSection(snakeSprite, spriteSection, drawLocation, origin, rotation);
 }
 bool IsMouseOverButton(Button button)
 {
@@ -403,18 +1612,68 @@ void CheckButtonHover(Button *button)
         button->hovered = false;
 }
 
+uint64_t freeCellsInWord(int word)
+{
+    // Returns the bits of the cells in a word of the bitboard that dont contain a wall, the snake or food
+    uint64_t freeBits = ~(occupancy.body[word] | occupancy.walls[word] | occupancy.food[word]);
+    int firstX = (word % occupancy.wordsPerRow) * 64;
+    if (boardSize - firstX < 64) // Remove the bits past the end of the row
+        freeBits &= ((uint64_t)1 << (boardSize - firstX)) - 1;
+    return freeBits;
+}
+bool findFreeCell(int n, Position *pos)
+{
+    // Finds the 'n'th free cell on the board by counting the free cells in each word of the bitboard
+    for (int word = 0; word < occupancy.wordCount; word++)
+    {
+        uint64_t freeBits = freeCellsInWord(word);
+        int count = __builtin_popcountll(freeBits);
+        if (n >= count)
+        {
+            n -= count;
+            continue;
+        }
+        for (int i = 0; i < n; i++)
+            freeBits &= freeBits - 1; // Remove the lowest free cells until the 'n'th one is the lowest
+        pos->x = (word % occupancy.wordsPerRow) * 64 + __builtin_ctzll(freeBits);
+        pos->y = word / occupancy.wordsPerRow;
+        return true;
+    }
+    return false;
+}
 void generateFood(Cell board[boardSize][boardSize], Snake *snake)
 {
-    if (numCellsToFill(snake, board) != 0) // Make sure the player hasnt won and that there are spaces to place food
+    int cellsToFill = numCellsToFill(snake, board);
+    if (cellsToFill != 0) // Make sure the player hasnt won and that there are spaces to place food
     {
         int x, y;
-        do
+        if (cellsToFill > boardSize * boardSize / 8)
+        {
+            do
+            {
+                // Keep generating x and y coordinates until a vaild cell is found
+                x = gameRandom() % boardSize;
+                y = gameRandom() % boardSize;
+            } while (isCellBlocked((Position){x, y}) || bitboardTest(occupancy.food, (Position){x, y}) || &board[x][y] == snake->snakeSegments[0]); // Ensure food is placed on an empty cell
+        }
+        else
         {
-            // Keep generating x and y coordinates until a vaild cell is found
-            x = rand() % boardSize;
-            y = rand() % boardSize;
-        } while (board[x][y].contents != EMPTY || &board[x][y] == snake->snakeSegments[0]); // Ensure food is placed on an empty cell
-        board[x][y].contents = FOOD; // Set the found cell to contain food
+            // Nearly full board so guessing would take too long, instead pick one of the free cells directly
+            int freeCount = 0;
+            for (int word = 0; word < occupancy.wordCount; word++)
+                freeCount += __builtin_popcountll(freeCellsInWord(word));
+            if (freeCount == 0)
+                return;
+
+            Position pos;
+            do
+            {
+                findFreeCell(gameRandom() % freeCount, &pos);
+            } while (&board[pos.x][pos.y] == snake->snakeSegments[0] && freeCount > 1); // Only place food in front of the snake if there is nowhere else
+            x = pos.x;
+            y = pos.y;
+        }
+        setCellContents(&board[x][y], FOOD); // Set the found cell to contain food
     }
 }
 void cleanup(Snake *snake)
@@ -422,46 +1681,85 @@ void cleanup(Snake *snake)
     // Clears the dynamic list in snake
     if (snake->snakeSegments != NULL)
     {
-        free(snake->snakeSegments);
+        gameFree(snake->snakeSegments);
         snake->snakeSegments = NULL; // Avoid dangling pointer
     }
+    snake->segmentCapacity = 0;
 }
 
 void initSnake(Snake *snake, Cell board[boardSize][boardSize])
 {
-    // Clear 'snakeSegments' list so it is ready to use again
-    cleanup(snake);
-    // Allocate the amount of memory needed to store the maximum length of the snake based on the size of the board
-    snake->snakeSegments = (Cell **)malloc(boardSize * boardSize * sizeof(Cell *));
-
-    // Store pointers to the board elements that make up the snake
-    for (int i = 0; i < boardSize * boardSize; i++)
+    if (snake->segmentCapacity < boardSize * boardSize)
+    {
+        // Allocate the amount of memory needed to store the maximum length of the snake based on the size of the board
+        cleanup(snake);
+        snake->snakeSegments = (Cell **)gameAlloc(boardSize * boardSize * sizeof(Cell *));
+        snake->segmentCapacity = boardSize * boardSize;
+        for (int i = 0; i < boardSize * boardSize; i++)
+        {
+            snake->snakeSegments[i] = NULL;
+        }
+    }
+    else
     {
-        snake->snakeSegments[i] = NULL;
+        // Reuse the list from the last game (only the segments up to the tail are ever set)
+        for (int i = 0; i <= snake->tailIndex; i++)
+        {
+            snake->snakeSegments[i] = NULL;
+        }
     }
     snake->snakeSegments[0] = &board[boardSize / 2 - 1][boardSize / 2]; // Head which is invisible and controls where the front of the snake will go when it moves
     snake->snakeSegments[1] = &board[boardSize / 2][boardSize / 2];     // Snake front: first displayed part of the snake
     snake->snakeSegments[1]->snakeSpriteDirection = LEFT;
-    snake->snakeSegments[1]->contents = SNAKEBODY;
+    setCellContents(snake->snakeSegments[1], SNAKEBODY);
     snake->snakeSegments[2] = &board[boardSize / 2 + 1][boardSize / 2]; // Snake body (the snake will start with a length of 2)
     snake->snakeSegments[2]->snakeSpriteDirection = LEFT;
     snake->snakeSegments[2]->snakeSpriteDirectionLeaving = LEFT;
-    snake->snakeSegments[2]->contents = SNAKEBODY;
+    setCellContents(snake->snakeSegments[2], SNAKEBODY);
     snake->snakeSegments[3] = &board[boardSize / 2 + 2][boardSize / 2]; // Snake body (the snake will start with a length of 2)
     snake->snakeSegments[3]->snakeSpriteDirection = LEFT;
     snake->snakeSegments[3]->snakeSpriteDirectionLeaving = LEFT;
-    snake->snakeSegments[3]->contents = SNAKEBODY;
+    setCellContents(snake->snakeSegments[3], SNAKEBODY);
 
     Position snakeFrontPos = snake->snakeSegments[1]->index;     // Store the index of the cell that contains the front of the snake so the head can rotate around it when turning
     SnakeHead snakeHead = {LEFT, NOTSET, NOTSET, snakeFrontPos}; // Create the head of the snake with a direction of LEFT and no user inputs set
     snake->head = snakeHead;                                     // Assign the head to the snake
+    positionHash ^= zobristDirectionKey(LEFT);
 
     snake->tailIndex = 4;     // Set the tail index (used to delete the tail of the snake when moving)
     snakeMouthState = CLOSED; // Set default mouth state
+    gameTick = 0;
+}
+void clearBoard(Snake *snake)
+{
+    // Empties a board that is already built for the current board size ready for a new game
+    // Only the bits of the last snake and food are cleared from the occupancy bitboard, starting a new generation makes every cell
+    // that isnt a wall read as empty without rewriting the cells
+    for (int i = 1; i <= snake->tailIndex; i++)
+    {
+        if (snake->snakeSegments[i] != NULL)
+        {
+            Position pos = snake->snakeSegments[i]->index;
+            occupancy.body[pos.y * occupancy.wordsPerRow + pos.x / 64] &= ~((uint64_t)1 << (pos.x % 64));
+        }
+    }
+    occupancy.food[foodPosition.y * occupancy.wordsPerRow + foodPosition.x / 64] &= ~((uint64_t)1 << (foodPosition.x % 64));
+    boardGeneration++;
+    positionHash = 0;
+    foodDistance.dirty = true;
+    memset(overview.dirtyRows, 0xff, (boardSize + 63) / 64 * sizeof(uint64_t)); // Cells were emptied without 'setCellContents'
+    minimap.rebuild = true;
 }
 void createBoard(Cell board[boardSize][boardSize])
 {
     // create empty board with walls all around it
+    boardGeneration++;
+    if (boardGeneration == 0) // Generation has wrapped round so start again (cells stamped with 0 can be left over from earlier games)
+        boardGeneration = 1;
+    resizeBitboard(&occupancy);        // Clear the occupancy bitboard so it matches the new board
+    resizeOverview();                  // Overview is rebuilt from the new board
+    minimap.rebuild = true;
+    resizeDistanceField(&foodDistance); // Autopilot distances are rebuilt once the new food has been placed
     for (int i = 0; i < boardSize; i++)
     {
         for (int j = 0; j < boardSize; j++)
@@ -469,206 +1767,1178 @@ void createBoard(Cell board[boardSize][boardSize])
             board[i][j].index = (Position){i, j};
             if (i == 0 || j == 0 || i == boardSize - 1 || j == boardSize - 1) // if current cell is at the edge of the board make it a wall
             {
-                board[i][j].contents = BOARDWALL;
+                setCellContents(&board[i][j], BOARDWALL);
             }
             else
             {
-                board[i][j].contents = EMPTY;
+                setCellContents(&board[i][j], EMPTY);
                 board[i][j].snakeSpriteDirection = NOTSET; // Reset sprite direction
             }
         }
     }
+    positionHash = 0; // Board is empty (cells left over from a bigger board may have changed the hash)
+    builtBoardSize = boardSize;
+    backgroundVersion++; // Walls have moved so cached chunks of the background are out of date
+    cameraSnap = true;
+}
+double getSeconds()
+{
+    // Seconds from an arbitrary point (GetTime only works once the window is open so startup is timed with this)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+void decodeAssets()
+{
+    // Claims and decodes assets until there are none left (run by the asset threads and the main thread)
+    int index;
+    while ((index = atomic_fetch_add(&nextAssetToDecode, 1)) < ASSETCOUNT)
+    {
+        Asset *asset = &assets[index];
+        if (asset->mapped)
+            continue;
+        if (asset->sprite != NULL)
+            asset->image = LoadImage(asset->fileName);
+        else
+            asset->wave = LoadWave(asset->fileName);
+        atomic_store_explicit(&asset->decoded, true, memory_order_release); // The main thread can upload it now
+    }
+}
+void *assetThread(void *arg)
+{
+    (void)arg;
+    decodeAssets();
+    return NULL;
+}
+bool mapAsset(Asset *asset)
+{
+    // Points the asset at its already decoded data in the bundle, returns false if the bundle doesnt have it
+    const BundleEntry *entry = bundle_find(assetBundle, asset->fileName);
+    if (entry == NULL)
+        return false;
+    void *data = (void *)bundle_data(assetBundle, entry); // raylib only reads it when uploading
+    if (asset->sprite != NULL && entry->kind == BUNDLE_IMAGE)
+        asset->image = (Image){data, entry->width, entry->height, 1, entry->format};
+    else if (asset->sound != NULL && entry->kind == BUNDLE_WAVE)
+        asset->wave = (Wave){entry->frameCount, entry->sampleRate, entry->sampleSize, entry->channels, data};
+    else
+        return false;
+    asset->mapped = true;
+    atomic_store(&asset->decoded, true);
+    return true;
+}
+void startAssetDecoding()
+{
+    // Maps the asset bundle and starts decoding every sprite and sound that isnt in it on worker threads
+    // (called before the window is opened so decoding overlaps with it)
+    int filesToDecode = ASSETCOUNT;
+    assetBundle = bundle_open(BUNDLE_DEFAULT_NAME);
+    if (assetBundle != NULL)
+    {
+        for (int i = 0; i < ASSETCOUNT; i++)
+        {
+            if (mapAsset(&assets[i]))
+                filesToDecode--;
+        }
+    }
+    atomic_store(&nextAssetToDecode, 0);
+    if (filesToDecode == 0)
+        return; // Everything is in the bundle
+    for (assetThreadCount = 0; assetThreadCount < ASSETTHREADS; assetThreadCount++)
+    {
+        if (pthread_create(&assetThreads[assetThreadCount], NULL, assetThread, NULL) != 0)
+            break; // Whatever isnt decoded by the threads that started is decoded by the main thread
+    }
+}
+void finishAssetDecoding()
+{
+    // Helps decode any assets that havent been claimed yet and waits for the asset threads to finish
+    decodeAssets();
+    for (int i = 0; i < assetThreadCount; i++)
+        pthread_join(assetThreads[i], NULL);
+    assetThreadCount = 0;
+}
+int paletteIndex(Color colour)
+{
+    // Returns the palette entry of 'colour', adding it if the palette doesnt have it yet (-1 if the palette is full)
+    if (colour.a == 0)
+        return PALETTEBLANK;
+    for (int i = PALETTEFIXED; i < paletteCount; i++)
+    {
+        if (spritePalette[i].r == colour.r && spritePalette[i].g == colour.g && spritePalette[i].b == colour.b && spritePalette[i].a == colour.a)
+            return i;
+    }
+    if (paletteCount == PALETTESIZE)
+        return -1;
+    spritePalette[paletteCount] = colour;
+    return paletteCount++;
+}
+void addToSpriteAtlas(Asset *asset)
+{
+    // Copies a sprite (5 frames 'ATLASFRAMESIZE' pixels high) into the next row of the atlas image as palette indices
+    Image *image = &asset->image;
+    if (image->data == NULL || image->width > ATLASWIDTH || image->width % 5 != 0 || image->height != ATLASFRAMESIZE)
+        return;
+    if (spriteAtlasImage.data == NULL) // Room for every asset to be a sprite (a quarter of the size of the same pixels in RGBA)
+        spriteAtlasImage = (Image){MemAlloc(ATLASWIDTH * ATLASFRAMESIZE * ASSETCOUNT), ATLASWIDTH, ATLASFRAMESIZE * ASSETCOUNT, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+    Color *pixels = LoadImageColors(*image); // Converted to 8 bit RGBA so the colours can be compared
+    if (pixels == NULL)
+        return;
+    unsigned char *row = (unsigned char *)spriteAtlasImage.data + spriteAtlasRows * ATLASWIDTH * ATLASFRAMESIZE;
+    for (int y = 0; y < image->height; y++)
+    {
+        for (int x = 0; x < image->width; x++)
+        {
+            int index = paletteIndex(pixels[y * image->width + x]);
+            if (index == -1) // Too many colours so the sprite is drawn from its own texture
+            {
+                memset(row, 0, ATLASWIDTH * ATLASFRAMESIZE);
+                UnloadImageColors(pixels);
+                return;
+            }
+            row[y * ATLASWIDTH + x] = index;
+        }
+    }
+    UnloadImageColors(pixels);
+    asset->sprite->atlasRow = spriteAtlasRows++;
+}
+Color skinColour(int skin, int index)
+{
+    // Returns palette entry 'index' coloured for 'skin'
+    Skin *colours = &skins[skin];
+    if (index == PALETTEBOARDLIGHT)
+        return colours->boardLight;
+    if (index == PALETTEBOARDDARK)
+        return colours->boardDark;
+    if (index == PALETTEWALL)
+        return colours->wall;
+    Color colour = spritePalette[index];
+    if (index == PALETTEBLANK || colour.r != colour.g || colour.g != colour.b) // Only grays are part of the skin
+        return colour;
+    float amount = colour.r / 255.0f;
+    return (Color){colours->dark.r + (colours->light.r - colours->dark.r) * amount, colours->dark.g + (colours->light.g - colours->dark.g) * amount,
+                   colours->dark.b + (colours->light.b - colours->dark.b) * amount, colour.a};
+}
+Color boardColour(int index)
+{
+    // Returns the colour to draw board chunks with for palette entry 'index' (chunks hold palette indices once the palette shader is loaded)
+    if (snakeRenderer.ready)
+        return (Color){index, 0, 0, 255};
+    return skinColour(currentSkin, index);
+}
+void setSkin(int skin)
+{
+    // Recolours the snake and the board (only the skin uniform changes once the palette is loaded)
+    currentSkin = skin;
+    if (snakeRenderer.ready)
+    {
+        float skinRow = (skin + 0.5f) / SKINCOUNT;
+        SetShaderValue(snakeRenderer.material.shader, snakeRenderer.skinLocation, &skinRow, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(snakeRenderer.paletteShader, snakeRenderer.paletteSkinLocation, &skinRow, SHADER_UNIFORM_FLOAT);
+    }
+    else
+        backgroundVersion++; // Chunks are drawn in the colours of the skin
+    if (overview.dirtyRows != NULL) // The overview and minimap are small enough to rebuild
+        memset(overview.dirtyRows, 0xff, (boardSize + 63) / 64 * sizeof(uint64_t));
+    minimap.rebuild = true;
+}
+void uploadAsset(Asset *asset)
+{
+    // Creates the texture or sound from the decoded asset (has to be on the main thread once the window and audio device are open)
+    if (asset->sprite != NULL)
+    {
+        asset->sprite->texture = LoadTextureFromImage(asset->image);
+        asset->sprite->atlasRow = -1; // Until it is added to the atlas
+        addToSpriteAtlas(asset);
+        if (!asset->mapped)
+            UnloadImage(asset->image);
+        asset->image = (Image){0};
+    }
+    else
+    {
+        *asset->sound = LoadSoundFromWave(asset->wave);
+        if (!asset->mapped)
+            UnloadWave(asset->wave);
+        asset->wave = (Wave){0};
+    }
+    asset->loaded = true;
+    assetsLoaded++;
 }
-void LoadSprites()
+void setSharedSprites()
 {
+    // Sprites that reuse the texture of another sprite (set once every texture is uploaded)
+
     // Leaving or filling an empty cell (snakes front or tail)
-    Texture2D emptySprite = LoadTexture("resources/snakeSprites/EnterOrLeaveEmpty.png");
-    EmptyCellSprites.enteringCell.main = emptySprite;
+    Sprite emptySprite = EmptyCellSprites.enteringCell.main;
     EmptyCellSprites.enteringCell.left = emptySprite;
     EmptyCellSprites.enteringCell.right = emptySprite;
     EmptyCellSprites.leavingCell.main = emptySprite;
     EmptyCellSprites.leavingCell.left = emptySprite;
     EmptyCellSprites.leavingCell.right = emptySprite;
 
-    // Snake Head
-    SnakeHeadSprites.enteringCell.main = LoadTexture("resources/snakeSprites/HeadEnter.png");
-
-    SnakeHeadSprites.leavingCell.main = LoadTexture("resources/snakeSprites/HeadLeave.png");
-    SnakeHeadSprites.leavingCell.left = LoadTexture("resources/snakeSprites/HeadLeaveLeft.png");
-    SnakeHeadSprites.leavingCell.right = LoadTexture("resources/snakeSprites/HeadLeaveRight.png");
-
-    // Snake death
-    SnakeDeathWallSprite = LoadTexture("resources/snakeSprites/HeadDeathWall.png");
-    SnakeDeathSnakeSprite = LoadTexture("resources/snakeSprites/HeadDeathSnakebody.png");
+    // Closing is the same as eating without the food layer
+    SnakeMouthCloseSprites.enteringCell.main = SnakeMouthEatSprites.enteringCell.main;
+    SnakeMouthCloseSprites.enteringCell.layer1 = emptySprite;
+    SnakeMouthCloseSprites.enteringCell.layer2 = SnakeMouthEatSprites.enteringCell.layer2;
 
-    // Snake Eat
-    SnakeMouthEatSprites.enteringCell.main = LoadTexture("resources/snakeSprites/HeadEatEnterBottom.png");
-    SnakeMouthEatSprites.enteringCell.layer1 = LoadTexture("resources/snakeSprites/HeadEatEnterFood.png");
-    SnakeMouthEatSprites.enteringCell.layer2 = LoadTexture("resources/snakeSprites/HeadEatEnterTop.png");
+    // Snake Tail
+    SnakeTailSprites.leavingCell.left = SnakeTailSprites.leavingCell.main;
+    SnakeTailSprites.leavingCell.right = SnakeTailSprites.leavingCell.main;
+}
+void initSnakeRenderer()
+{
+    // Uploads the sprite atlas and creates the snake shader and vertex buffer (the snake is drawn a sprite at a time if any of it fails)
+    if (spriteAtlasImage.data == NULL)
+        return;
+    Texture2D atlas = LoadTextureFromImage(spriteAtlasImage);
+    UnloadImage(spriteAtlasImage);
+    spriteAtlasImage = (Image){0};
+
+    // Every skin coloured into its own row of the palette texture so changing skin is just a uniform
+    Image paletteImage = GenImageColor(PALETTESIZE, SKINCOUNT, BLANK);
+    for (int skin = 0; skin < SKINCOUNT; skin++)
+    {
+        for (int i = 0; i < paletteCount; i++)
+            ((Color *)paletteImage.data)[skin * PALETTESIZE + i] = skinColour(skin, i);
+    }
+    Texture2D palette = LoadTextureFromImage(paletteImage);
+    UnloadImage(paletteImage);
+
+    Shader shader = LoadShaderFromMemory(snakeVertexShader, snakeFragmentShader);
+    Shader paletteShader = LoadShaderFromMemory(NULL, snakeFragmentShader); // raylibs default vertex shader
+    int frameLocation = GetShaderLocation(shader, "frame"); // -1 if raylib fell back to its default shader
+    int paletteLocation = GetShaderLocation(paletteShader, "texture1");
+    if (atlas.id == 0 || palette.id == 0 || !IsShaderValid(shader) || !IsShaderValid(paletteShader) || frameLocation == -1 || paletteLocation == -1)
+    {
+        UnloadTexture(atlas);
+        UnloadTexture(palette);
+        UnloadShader(shader);
+        UnloadShader(paletteShader);
+        return;
+    }
 
-    SnakeMouthCloseSprites.enteringCell.main = LoadTexture("resources/snakeSprites/HeadEatEnterBottom.png");
-    SnakeMouthCloseSprites.enteringCell.layer1 = emptySprite;
-    SnakeMouthCloseSprites.enteringCell.layer2 = LoadTexture("resources/snakeSprites/HeadEatEnterTop.png");
+    SnakeRenderer *renderer = &snakeRenderer;
+    renderer->material = LoadMaterialDefault();
+    renderer->material.shader = shader;
+    renderer->material.maps[MATERIAL_MAP_DIFFUSE].texture = atlas;
+    renderer->material.maps[MATERIAL_MAP_SPECULAR].texture = palette; // Bound as 'texture1'
+    renderer->frameLocation = frameLocation;
+    renderer->skinLocation = GetShaderLocation(shader, "skinRow");
+    renderer->paletteShader = paletteShader;
+    renderer->paletteLocation = paletteLocation;
+    renderer->paletteSkinLocation = GetShaderLocation(paletteShader, "skinRow");
+    renderer->mesh = (Mesh){0};
+    renderer->mesh.vertexCount = SNAKEQUADCAPACITY * SNAKESLOTVERTICES;
+    renderer->mesh.triangleCount = renderer->mesh.vertexCount / 3;
+    renderer->mesh.vertices = (float *)MemAlloc(renderer->mesh.vertexCount * 3 * sizeof(float)); // Every quad starts with no area
+    renderer->mesh.texcoords = (float *)MemAlloc(renderer->mesh.vertexCount * 2 * sizeof(float));
+    UploadMesh(&renderer->mesh, true); // Dynamic so slots can be rewritten
+    renderer->particleMesh = (Mesh){0};
+    renderer->particleMesh.vertexCount = PARTICLECAPACITY * PARTICLEVERTICES;
+    renderer->particleMesh.triangleCount = renderer->particleMesh.vertexCount / 3;
+    renderer->particleMesh.vertices = (float *)MemAlloc(renderer->particleMesh.vertexCount * 3 * sizeof(float));
+    renderer->particleMesh.texcoords = (float *)MemAlloc(renderer->particleMesh.vertexCount * 2 * sizeof(float));
+    UploadMesh(&renderer->particleMesh, true);
+    particles.dirtyFrom = 0; // Particles alive before now have no texture coordinates yet
+    renderer->slotCount = 0;
+    renderer->freeCount = 0;
+    renderer->ready = true;
+    setSkin(currentSkin);
+    backgroundVersion++; // Chunks drawn before now hold colours instead of palette indices
+
+    // Sprites in the atlas are drawn from it from now on so their own textures arent needed
+    for (int i = 0; i < ASSETCOUNT; i++)
+    {
+        if (assets[i].sprite != NULL && assets[i].sprite->atlasRow != -1)
+        {
+            UnloadTexture(assets[i].sprite->texture);
+            assets[i].sprite->texture.id = 0;
+        }
+    }
+}
+void unloadSnakeRenderer()
+{
+    if (!snakeRenderer.ready)
+        return;
+    UnloadMesh(snakeRenderer.mesh);
+    UnloadMesh(snakeRenderer.particleMesh);
+    UnloadMaterial(snakeRenderer.material); // Also unloads the shader, atlas and palette
+    UnloadShader(snakeRenderer.paletteShader);
+    snakeRenderer.ready = false;
+}
+bool loadAssets(double timeBudget)
+{
+    // Creates the textures and sounds of assets that have finished decoding until 'timeBudget' seconds have been spent
+    // Called between frames so the sprites and sounds stream in while the start menu is shown, returns true once they are all loaded
+    if (assetsReady)
+        return true;
+    double startTime = getSeconds();
+    if (!IsAudioDeviceReady())
+    {
+        InitAudioDevice(); // Started after the first frame so it doesnt hold up the start menu
+        startupTimes.audio = getSeconds();
+    }
+    for (int i = 0; i < ASSETCOUNT && getSeconds() - startTime < timeBudget; i++)
+    {
+        if (!assets[i].loaded && atomic_load_explicit(&assets[i].decoded, memory_order_acquire))
+            uploadAsset(&assets[i]);
+    }
+    if (assetsLoaded < ASSETCOUNT)
+        return false;
+
+    finishAssetDecoding(); // Everything has been decoded so this only joins the asset threads
+    initSnakeRenderer();
+    setSharedSprites(); // After the sprites in the atlas have let go of their textures so the copies dont hold freed texture ids
+    bundle_close(assetBundle); // Everything has been copied out of the bundle
+    assetBundle = NULL;
+    assetsReady = true;
+    startupTimes.interactive = getSeconds();
+    return true;
+}
+void waitForAssets()
+{
+    // Loads every asset that hasnt streamed in yet (only blocks if a game is started very soon after the game opens)
+    if (assetsReady)
+        return;
+    startupTimes.blockedFrom = getSeconds();
+    finishAssetDecoding(); // Decode whatever hasnt been claimed by the asset threads on this thread too
+    loadAssets(1.0e9); // No time limit
+}
+double getCpuSeconds()
+{
+    // CPU time used by every thread of the game
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+bool hadInput()
+{
+    // Returns true if a key was pressed or the mouse was used since the last frame
+    Vector2 mouseMove = GetMouseDelta();
+    return GetKeyPressed() != 0 || mouseMove.x != 0.0f || mouseMove.y != 0.0f || GetMouseWheelMove() != 0.0f || IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+}
+void paceFrames(bool paused)
+{
+    // Static screens are only drawn again when there is input (hovering a button, a key or a resized window) so they use no CPU while
+    // nobody is using them. Paused games drop to 'PAUSEDFPS' and go back to the full frame rate on the first frame with input
+    if (hadInput())
+        pacing.lastInput = GetTime();
+    bool staticScreen = gameState == STARTMENU || gameState == WINSCREEN || gameState == DEATHSCREEN;
+    bool waitForEvents = staticScreen && assetsReady && particles.count == 0; // Assets stream in and particles fly between frames so keep drawing until they are done
+    if (waitForEvents != pacing.waitingForEvents)
+    {
+        if (waitForEvents)
+            EnableEventWaiting();
+        else
+            DisableEventWaiting();
+        pacing.waitingForEvents = waitForEvents;
+    }
+    int fps = paused && gameState == GAME && GetTime() - pacing.lastInput > PAUSEDIDLESECONDS ? PAUSEDFPS : FULLFPS;
+    if (fps != pacing.fps)
+    {
+        SetTargetFPS(fps);
+        pacing.fps = fps;
+    }
+}
+void recordFrameTime(bool paused)
+{
+    // Adds the CPU and wall time since the last frame to the state the frame was drawn in
+    double cpu = getCpuSeconds();
+    double wall = getSeconds();
+    int state = paused && gameState == GAME ? PAUSEDSTATE : gameState;
+    if (pacing.lastWall != 0.0)
+    {
+        pacing.cpuTime[state] += cpu - pacing.lastCpu;
+        pacing.wallTime[state] += wall - pacing.lastWall;
+    }
+    pacing.lastCpu = cpu;
+    pacing.lastWall = wall;
+}
+void printCpuUse()
+{
+    // Prints the CPU use of each state as a percentage of one core
+    const char *names[PACINGSTATES] = {"start menu", "game", "death screen", "win screen", "death animation", "paused"};
+    printf("CPU use:");
+    for (int i = 0; i < PACINGSTATES; i++)
+    {
+        if (pacing.wallTime[i] > 0.0)
+            printf(" %s %.1f%% (%.1f s)", names[i], pacing.cpuTime[i] / pacing.wallTime[i] * 100.0, pacing.wallTime[i]);
+    }
+    printf("\n");
+}
+void printStartupTimes()
+{
+    // Prints how long it took to show the start menu and to be able to start a game
+    StartupTimes *times = &startupTimes;
+    // Every time is measured from when the game started running
+    printf("Startup: first frame %.1f ms (window open at %.1f ms), interactive %.1f ms (audio device started at %.1f ms)\n",
+           (times->firstFrame - times->start) * 1000.0, (times->window - times->start) * 1000.0, (times->interactive - times->start) * 1000.0,
+           (times->audio - times->start) * 1000.0);
+    if (times->blockedFrom != 0.0)
+        printf("Startup: a game was started before the assets were ready and waited %.1f ms for them\n", (times->interactive - times->blockedFrom) * 1000.0);
+    times->printed = true;
+}
+void initGame(Snake *snake, Cell board[boardSize][boardSize])
+{
+    if (mctsBot != NULL) // Stop searching the last game
+        mcts_stop(mctsBot, NULL);
+    cycleOrderTick = UINT64_MAX; // New snake hasnt been checked against the cycle
+    if (builtBoardSize == boardSize && snake->segmentCapacity != 0 && boardGeneration != 0xffffffffu)
+        clearBoard(snake); // Same size board as the last game so only the last snake and food need clearing
+    else
+        createBoard(board);
+    initSnake(snake, board);
+    generateFood(board, snake);
+}
+int snapCellSize(int cellSize)
+{
+    // Rounds cell sizes bigger than the sprites down to a whole multiple of the sprite size so every sprite pixel is scaled up evenly
+    return cellSize > ATLASFRAMESIZE ? cellSize / ATLASFRAMESIZE * ATLASFRAMESIZE : cellSize;
+}
+int fitCellSize()
+{
+    // Returns the biggest cell size that fits the whole board on the screen (not snapped to the sprite size so boards that fit fill the screen)
+    int cellSize = screenHeight / boardSize;
+    return cellSize < 1 ? 1 : cellSize;
+}
+void getZoomLimits(int *smallestCellSize, int *biggestCellSize)
+{
+    // The camera can zoom out until the whole board fits on the screen and in to 'MAXCELLSIZE' (boards that fit at a bigger size cant zoom)
+    int fitSize = fitCellSize();
+    *smallestCellSize = fitSize < MINCELLSIZE ? MINCELLSIZE : fitSize;
+    *biggestCellSize = fitSize > MAXCELLSIZE ? fitSize : MAXCELLSIZE;
+}
+void initBoardSizes(int *cellSize, Position *boardStart)
+{
+    *cellSize = fitCellSize(); // Find the width and the height for each square on the board
+    if (*cellSize < FOLLOWCELLSIZE) // Large boards dont fit on the screen so the camera follows the snake around them instead
+        *cellSize = FOLLOWCELLSIZE;
+    cameraSnap = true;
+    int boardStartX = (screenWidth / 2) - (*cellSize * boardSize / 2); // Calculate where to start drawing the board
+    int boardStartY = (screenHeight - *cellSize * boardSize) / 2;      // Calculate where to start drawing the board
+    *boardStart = (Position){boardStartX, boardStartY};                // Store the board starting position
+}
+int difficultyBoardSize(int difficulty)
+{
+    // Returns the size of the board (walls included) for 'difficulty'
+    int size = 14; // Expert
+    if (difficulty == 0) // Easy
+        size = 6;
+    else if (difficulty == 1) // Medium
+        size = 8;
+    else if (difficulty == 2) // Hard
+        size = 12;
+    if (customBoardSize != 0) // Board size from the command line replaces the size for the difficulty (the snake speed is kept)
+        size = customBoardSize;
+    return size + 2; // add 2 to board size so there is space for walls
+}
+void setDifficultySettings(int difficulty, float *snakeUpdateBaseInterval)
+{
+    // Set the speed of the snake and the size of the board based on the users selected difficulty
+    if (difficulty == 0) // Easy
+        *snakeUpdateBaseInterval = 0.3f;
+    else if (difficulty == 1) // Medium
+        *snakeUpdateBaseInterval = 0.2f;
+    else if (difficulty == 2) // Hard
+        *snakeUpdateBaseInterval = 0.15f;
+    else if (difficulty == 3) // Expert
+        *snakeUpdateBaseInterval = 0.09f;
+    boardSize = difficultyBoardSize(difficulty);
+}
 
-    // Snake Mouth Open
-    SnakeMouthOpenSprites.enteringCell.main = LoadTexture("resources/snakeSprites/HeadOpenEnter.png");
+void DrawStartScreen(Button *buttons[])
+{
+    // Start menu
+    drawCachedText(HUDTITLE, STARTMENU, screenWidth / 2, 40, TEXTCENTER, 90, BLACK, "SNAKE");
 
-    SnakeMouthOpenSprites.leavingCell.main = LoadTexture("resources/snakeSprites/HeadOpenLeave.png");
-    SnakeMouthOpenSprites.leavingCell.left = LoadTexture("resources/snakeSprites/HeadOpenLeaveLeft.png");
-    SnakeMouthOpenSprites.leavingCell.right = LoadTexture("resources/snakeSprites/HeadOpenLeaveRight.png");
+    // Difficulty buttons
+    DrawButton(*buttons[0]);
+    DrawButton(*buttons[1]);
+    DrawButton(*buttons[2]);
+    DrawButton(*buttons[3]);
 
-    // Snake Body
-    SnakeBodySprites.enteringCell.main = LoadTexture("resources/snakeSprites/BodyEnter.png");
-    SnakeBodySprites.enteringCell.left = LoadTexture("resources/snakeSprites/BodyEnterLeft.png");
-    SnakeBodySprites.enteringCell.right = LoadTexture("resources/snakeSprites/BodyEnterRight.png");
+    drawCachedText(HUDPROMPT, STARTMENU, screenWidth / 2, 480, TEXTCENTER, 23, BLACK, "PRESS [ENTER] TO START!");
+}
+void updateCamera(Snake *snake, int cellSize, Position *boardStart)
+{
+    // Works out where the board is drawn on the screen: centred if it fits, otherwise following the front of the snake
+    int boardPixels = boardSize * cellSize;
+    if (boardPixels <= screenWidth && boardPixels <= screenHeight)
+    {
+        *boardStart = (Position){(screenWidth / 2) - (boardPixels / 2), (screenHeight - boardPixels) / 2}; // Same as 'initBoardSizes'
+        cameraSnap = true;
+        return;
+    }
 
-    SnakeBodySprites.leavingCell.main = LoadTexture("resources/snakeSprites/BodyLeave.png");
-    SnakeBodySprites.leavingCell.left = LoadTexture("resources/snakeSprites/BodyLeaveLeft.png");
-    SnakeBodySprites.leavingCell.right = LoadTexture("resources/snakeSprites/BodyLeaveRight.png");
+    Cell *frontCell = snake->snakeSegments[1] != NULL ? snake->snakeSegments[1] : snake->snakeSegments[2]; // The front is removed while the snake is dying
+    Position front = frontCell->index;
+    Vector2 target = {(front.x + 0.5f) * cellSize, (front.y + 0.5f) * cellSize};
+    float distanceX = target.x - cameraCenter.x;
+    float distanceY = target.y - cameraCenter.y;
+    if (cameraSnap || distanceX * distanceX + distanceY * distanceY > (float)screenWidth * screenWidth) // New game or loaded snapshot
+    {
+        cameraCenter = target;
+        cameraSnap = false;
+    }
+    else
+    {
+        float follow = GetFrameTime() * CAMERAFOLLOWSPEED;
+        if (follow > 1.0f)
+            follow = 1.0f;
+        cameraCenter.x += distanceX * follow;
+        cameraCenter.y += distanceY * follow;
+    }
 
-    // Snake Tail
-    SnakeTailSprites.enteringCell.main = LoadTexture("resources/snakeSprites/TailEnter.png");
-    SnakeTailSprites.enteringCell.left = LoadTexture("resources/snakeSprites/TailEnterLeft.png");
-    SnakeTailSprites.enteringCell.right = LoadTexture("resources/snakeSprites/TailEnterRight.png");
+    // Centre an axis the board fits along, otherwise keep the edges of the board from coming onto the screen
+    boardStart->x = screenWidth / 2 - (int)cameraCenter.x;
+    if (boardPixels <= screenWidth)
+        boardStart->x = (screenWidth - boardPixels) / 2;
+    else if (boardStart->x > 0)
+        boardStart->x = 0;
+    else if (boardStart->x < screenWidth - boardPixels)
+        boardStart->x = screenWidth - boardPixels;
+    boardStart->y = screenHeight / 2 - (int)cameraCenter.y;
+    if (boardPixels <= screenHeight)
+        boardStart->y = (screenHeight - boardPixels) / 2;
+    else if (boardStart->y > 0)
+        boardStart->y = 0;
+    else if (boardStart->y < screenHeight - boardPixels)
+        boardStart->y = screenHeight - boardPixels;
+}
+void zoomInputs(int *cellSize)
+{
+    // Zooms the camera in and out with the mouse wheel or [-] and [=] keeping the same point of the board in the middle of the screen
+    int smallestCellSize, biggestCellSize;
+    getZoomLimits(&smallestCellSize, &biggestCellSize);
+    float wheel = GetMouseWheelMove();
+    int newCellSize = *cellSize;
+    if (wheel > 0.0f || IsKeyPressed(KEY_EQUAL))
+        newCellSize += newCellSize >= ATLASFRAMESIZE ? ATLASFRAMESIZE : newCellSize / 4 > 1 ? newCellSize / 4 : 1;
+    else if (wheel < 0.0f || IsKeyPressed(KEY_MINUS))
+        newCellSize -= newCellSize > ATLASFRAMESIZE ? ATLASFRAMESIZE : newCellSize / 5 > 1 ? newCellSize / 5 : 1;
+    newCellSize = snapCellSize(newCellSize); // Steps in whole multiples of the sprite size once the sprites are scaled up
+    if (newCellSize < smallestCellSize)
+        newCellSize = smallestCellSize;
+    if (newCellSize > biggestCellSize)
+        newCellSize = biggestCellSize;
+    if (newCellSize == *cellSize)
+        return;
+    cameraCenter.x *= (float)newCellSize / *cellSize;
+    cameraCenter.y *= (float)newCellSize / *cellSize;
+    *cellSize = newCellSize;
+}
+int chunkCells(int cellSize)
+{
+    // Returns the width and height of a chunk in cells at 'cellSize'
+    int cells = CHUNKPIXELS / cellSize;
+    return cells < 1 ? 1 : cells;
+}
+void renderBoardChunk(BoardChunk *chunk, Cell board[boardSize][boardSize])
+{
+    // Draws the walls and checkerboard of the cells in the chunk into its texture
+    int cells = chunkCells(chunk->cellSize);
+    int pixels = cells * chunk->cellSize;
+    resizeRenderTarget(&chunk->texture, pixels, pixels);
+    EndShaderMode(); // Chunks can be drawn in the middle of drawing other chunks with the palette shader
+    pushRenderTarget(&chunk->texture);
+    ClearBackground(BLANK); // Parts of the chunk past the edge of the board are left see-through
+    int startX = chunk->chunkX * cells;
+    int startY = chunk->chunkY * cells;
+    Color boardLight = boardColour(PALETTEBOARDLIGHT);
+    Color boardDark = boardColour(PALETTEBOARDDARK);
+    Color wall = boardColour(PALETTEWALL);
+    for (int i = startX; i < startX + cells && i < boardSize; i++)
+    {
+        for (int j = startY; j < startY + cells && j < boardSize; j++)
+        {
+            Color colour = (i + j) % 2 == 0 ? boardLight : boardDark; // Alternate between the two board colours for all cells that arent walls
+            if (cellContents(&board[i][j]) == BOARDWALL)
+                colour = wall;
+            DrawRectangle((i - startX) * chunk->cellSize, (j - startY) * chunk->cellSize, chunk->cellSize, chunk->cellSize, colour);
+        }
+    }
+    popRenderTarget();
+}
+BoardChunk *getBoardChunk(int chunkX, int chunkY, int cellSize, Cell board[boardSize][boardSize])
+{
+    // Returns the chunk with its background drawn, reusing the cached texture if the chunk hasnt changed since it was drawn
+    BoardChunk *chunk = &chunkCache[0];
+    for (int i = 0; i < CHUNKCACHESIZE; i++)
+    {
+        BoardChunk *slot = &chunkCache[i];
+        if (slot->cellSize == cellSize && slot->chunkX == chunkX && slot->chunkY == chunkY)
+        {
+            chunk = slot;
+            break;
+        }
+        if (slot->lastUsed < chunk->lastUsed)
+            chunk = slot; // Least recently used slot so far
+    }
+    if (chunk->cellSize != cellSize || chunk->chunkX != chunkX || chunk->chunkY != chunkY || chunk->version != backgroundVersion)
+    {
+        chunk->chunkX = chunkX;
+        chunk->chunkY = chunkY;
+        chunk->cellSize = cellSize;
+        chunk->version = backgroundVersion;
+        renderBoardChunk(chunk, board);
+    }
+    chunk->lastUsed = boardDrawCount;
+    return chunk;
+}
+void unloadBoardChunks()
+{
+    for (int i = 0; i < CHUNKCACHESIZE; i++)
+    {
+        if (chunkCache[i].texture.id != 0)
+            UnloadRenderTexture(chunkCache[i].texture);
+        chunkCache[i] = (BoardChunk){0};
+    }
+}
+bool overviewRowDirty(int y)
+{
+    return overview.dirtyRows[y / 64] >> (y % 64) & 1;
+}
+void buildOverviewRow(int y)
+{
+    // Colours the texels of row 'y' of the overview from the occupancy bitboard
+    Color *row = overview.pixels + y * boardSize;
+    Color boardLight = skinColour(currentSkin, PALETTEBOARDLIGHT);
+    Color boardDark = skinColour(currentSkin, PALETTEBOARDDARK);
+    for (int x = 0; x < boardSize; x++)
+    {
+        int word = y * occupancy.wordsPerRow + x / 64;
+        uint64_t bit = (uint64_t)1 << (x % 64);
+        if (occupancy.walls[word] & bit)
+            row[x] = skins[currentSkin].wall;
+        else if (occupancy.body[word] & bit)
+            row[x] = skins[currentSkin].dark;
+        else if (occupancy.food[word] & bit)
+            row[x] = RED; // Brighter than the food sprite so it can still be found when it is a few pixels wide
+        else
+            row[x] = (x + y) % 2 == 0 ? boardLight : boardDark;
+    }
+}
+void updateOverview()
+{
+    // Rebuilds the rows of the overview that have changed and uploads them (a new texture is made when the board size changes)
+    if (overview.texture.id != 0 && overview.texture.width != boardSize)
+    {
+        UnloadTexture(overview.texture);
+        overview.texture = (Texture2D){0};
+        memset(overview.dirtyRows, 0xff, (boardSize + 63) / 64 * sizeof(uint64_t));
+    }
+    for (int y = 0; y < boardSize; y++)
+    {
+        if (!overviewRowDirty(y))
+            continue;
+        int lastDirtyRow = y;
+        while (lastDirtyRow + 1 < boardSize && overviewRowDirty(lastDirtyRow + 1))
+            lastDirtyRow++;
+        for (int row = y; row <= lastDirtyRow; row++)
+            buildOverviewRow(row);
+        if (overview.texture.id != 0) // Each run of changed rows is uploaded in one go as the rows are next to each other in 'pixels'
+            UpdateTextureRec(overview.texture, (Rectangle){0, y, boardSize, lastDirtyRow - y + 1}, overview.pixels + y * boardSize);
+        y = lastDirtyRow;
+    }
+    memset(overview.dirtyRows, 0, (boardSize + 63) / 64 * sizeof(uint64_t));
+    if (overview.texture.id == 0)
+    {
+        Image image = {overview.pixels, boardSize, boardSize, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        overview.texture = LoadTextureFromImage(image);
+    }
+}
+void unloadOverview()
+{
+    if (overview.texture.id != 0)
+        UnloadTexture(overview.texture);
+    overview.texture = (Texture2D){0};
+}
+Color minimapTexelColour(int texel)
+{
+    // Food is shown over the snake and the snake over the walls so the important parts of a block can always be seen
+    int texelX = texel % minimap.size;
+    int texelY = texel / minimap.size;
+    if (foodPosition.x / minimap.cellsPerTexel == texelX && foodPosition.y / minimap.cellsPerTexel == texelY && bitboardTest(occupancy.food, foodPosition))
+        return RED;
+    if (minimap.snakeCells[texel] > 0)
+        return skins[currentSkin].dark;
+    if (texelX == 0 || texelY == 0 || texelX == minimap.size - 1 || texelY == minimap.size - 1) // Walls are only around the edge of the board
+        return skins[currentSkin].wall;
+    return skins[currentSkin].boardLight;
+}
+void rebuildMinimap()
+{
+    // Counts the snake cells in every block from the occupancy bitboard and recolours every texel
+    minimap.cellsPerTexel = (boardSize + MINIMAPSIZE - 1) / MINIMAPSIZE;
+    minimap.size = (boardSize + minimap.cellsPerTexel - 1) / minimap.cellsPerTexel;
+    memset(minimap.snakeCells, 0, sizeof(minimap.snakeCells));
+    for (int y = 0; y < boardSize; y++)
+    {
+        for (int word = 0; word < occupancy.wordsPerRow; word++)
+        {
+            uint64_t bits = occupancy.body[y * occupancy.wordsPerRow + word];
+            while (bits != 0)
+            {
+                int x = word * 64 + __builtin_ctzll(bits);
+                minimap.snakeCells[y / minimap.cellsPerTexel * minimap.size + x / minimap.cellsPerTexel]++;
+                bits &= bits - 1;
+            }
+        }
+    }
+    for (int texel = 0; texel < minimap.size * minimap.size; texel++)
+        minimap.pixels[texel] = minimapTexelColour(texel);
+    minimap.dirtyCount = 0;
+    minimap.rebuild = false;
+}
+void updateMinimap()
+{
+    // Uploads the texels that changed since the minimap was last drawn (or all of them after a rebuild)
+    if (minimap.rebuild)
+    {
+        rebuildMinimap();
+        if (minimap.texture.id != 0 && minimap.texture.width != minimap.size)
+        {
+            UnloadTexture(minimap.texture);
+            minimap.texture = (Texture2D){0};
+        }
+        if (minimap.texture.id == 0)
+            minimap.texture = LoadTextureFromImage((Image){minimap.pixels, minimap.size, minimap.size, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8});
+        else
+            UpdateTexture(minimap.texture, minimap.pixels);
+        return;
+    }
+    for (int i = 0; i < minimap.dirtyCount; i++)
+    {
+        int texel = minimap.dirtyTexels[i];
+        minimap.pixels[texel] = minimapTexelColour(texel);
+        UpdateTextureRec(minimap.texture, (Rectangle){texel % minimap.size, texel / minimap.size, 1, 1}, &minimap.pixels[texel]);
+    }
+    minimap.dirtyCount = 0;
+}
+void drawMinimap(int cellSize, Position boardStart)
+{
+    // Draws the minimap in the bottom right corner with an outline around the part of the board on the screen
+    int boardPixels = boardSize * cellSize;
+    if (boardPixels <= screenWidth && boardPixels <= screenHeight) // Whole board is already on the screen
+        return;
+    updateMinimap();
+    Rectangle area = {screenWidth - MINIMAPPIXELS - 10, screenHeight - MINIMAPPIXELS - 10, MINIMAPPIXELS, MINIMAPPIXELS};
+    DrawTexturePro(minimap.texture, (Rectangle){0, 0, minimap.size, minimap.size}, area, (Vector2){0, 0}, 0.0f, WHITE);
+    float cellPixels = (float)MINIMAPPIXELS / (minimap.size * minimap.cellsPerTexel); // Size of a cell on the minimap
+    Rectangle view = {area.x - boardStart.x * cellPixels / cellSize, area.y - boardStart.y * cellPixels / cellSize, screenWidth * cellPixels / cellSize, screenHeight * cellPixels / cellSize};
+    DrawRectangleLinesEx(GetCollisionRec(view, area), 1.0f, BLUE);
+}
+void unloadMinimap()
+{
+    if (minimap.texture.id != 0)
+        UnloadTexture(minimap.texture);
+    minimap.texture = (Texture2D){0};
+    minimap.rebuild = true;
+}
+void writeSnakeQuad(int slot, int layer, Position index, Sprite sprite, int direction)
+{
+    // Writes the two triangles of one sprite of a cell into the vertex arrays, rotated the same way as 'AnimateSprite'
+    static const float cornerX[6] = {-0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f}; // Top left, bottom left, bottom right, top left, bottom right, top right
+    static const float cornerY[6] = {-0.5f, 0.5f, 0.5f, -0.5f, 0.5f, -0.5f};
+    float *positions = snakeRenderer.mesh.vertices + (slot * SNAKESLOTVERTICES + layer * 6) * 3;
+    float *texcoords = snakeRenderer.mesh.texcoords + (slot * SNAKESLOTVERTICES + layer * 6) * 2;
+    int row = sprite.atlasRow;
+    if (row == -1)
+    {
+        memset(positions, 0, 6 * 3 * sizeof(float)); // No area so nothing is drawn
+        return;
+    }
+    float rotation = spriteRoatationFromDirection(direction);
+    float cosine = rotation == 0.0f ? 1.0f : rotation == 180.0f ? -1.0f : 0.0f; // Sprites are only turned by quarter turns
+    float sine = rotation == 90.0f ? 1.0f : rotation == -90.0f ? -1.0f : 0.0f;
+    for (int i = 0; i < 6; i++)
+    {
+        positions[i * 3] = index.x + 0.5f + cornerX[i] * cosine - cornerY[i] * sine;
+        positions[i * 3 + 1] = index.y + 0.5f + cornerX[i] * sine + cornerY[i] * cosine;
+        positions[i * 3 + 2] = 0.0f;
+        texcoords[i * 2] = cornerX[i] + 0.5f;                                                            // Inside one frame (the shader moves it to the current frame)
+        texcoords[i * 2 + 1] = (row + cornerY[i] + 0.5f) / ASSETCOUNT; // Row of the sprite in the atlas (which has a row for every asset)
+    }
+}
+void uploadSnakeSlot(int slot)
+{
+    int offset = slot * SNAKESLOTVERTICES;
+    UpdateMeshBuffer(snakeRenderer.mesh, 0, snakeRenderer.mesh.vertices + offset * 3, SNAKESLOTVERTICES * 3 * sizeof(float), offset * 3 * sizeof(float));
+    UpdateMeshBuffer(snakeRenderer.mesh, 1, snakeRenderer.mesh.texcoords + offset * 2, SNAKESLOTVERTICES * 2 * sizeof(float), offset * 2 * sizeof(float));
+}
+bool updateSnakeSlot(Cell *cell)
+{
+    // Gives 'cell' a slot if it doesnt have one and rewrites its quads if its sprites have changed, returns false if there are no slots left
+    SnakeRenderer *renderer = &snakeRenderer;
+    int slot = cell->quadSlot;
+    if (slot < 0 || slot >= renderer->slotCount || renderer->slots[slot].cell != cell)
+    {
+        if (renderer->freeCount > 0)
+            slot = renderer->freeSlots[--renderer->freeCount];
+        else if (renderer->slotCount < SNAKEQUADCAPACITY)
+            slot = renderer->slotCount++;
+        else
+            return false;
+        renderer->slots[slot] = (SnakeQuadSlot){.cell = cell, .index = {-1, -1}}; // Index that no cell has so the quads are written
+        cell->quadSlot = slot;
+    }
 
-    SnakeTailSprites.leavingCell.main = LoadTexture("resources/snakeSprites/TailLeave.png");
-    SnakeTailSprites.leavingCell.left = SnakeTailSprites.leavingCell.main;
-    SnakeTailSprites.leavingCell.right = SnakeTailSprites.leavingCell.main;
+    SnakeQuadSlot *quads = &renderer->slots[slot];
+    quads->drawnFrame = boardDrawCount;
+    Sprite sprites[SNAKEQUADLAYERS] = {cell->spriteEnteringCell, cell->spriteLeavingCell, cell->layer1, cell->layer2};
+    int directions[SNAKEQUADLAYERS] = {cell->snakeSpriteDirection, cell->snakeSpriteDirectionLeaving, LEFT, cell->snakeSpriteDirection}; // Food doesnt rotate
+    if (!cell->multipleLayers) // Snake mouth eat and close are the only sprites with extra layers
+        sprites[2].atlasRow = sprites[3].atlasRow = -1;
+    bool changed = quads->index.x != cell->index.x || quads->index.y != cell->index.y;
+    for (int layer = 0; layer < SNAKEQUADLAYERS; layer++)
+        changed = changed || quads->sprites[layer] != sprites[layer].atlasRow || quads->directions[layer] != directions[layer];
+    if (!changed)
+        return true;
 
-    // Tail Lengthen
-    TailLengthenSprites.enteringCell.main = LoadTexture("resources/snakeSprites/TailLengthen.png");
-    TailLengthenSprites.enteringCell.left = LoadTexture("resources/snakeSprites/TailLengthenLeft.png");
-    TailLengthenSprites.enteringCell.right = LoadTexture("resources/snakeSprites/TailLengthenRight.png");
+    quads->index = cell->index;
+    for (int layer = 0; layer < SNAKEQUADLAYERS; layer++)
+    {
+        quads->sprites[layer] = sprites[layer].atlasRow;
+        quads->directions[layer] = directions[layer];
+        writeSnakeQuad(slot, layer, cell->index, sprites[layer], directions[layer]);
+    }
+    uploadSnakeSlot(slot);
+    return true;
+}
+bool drawSnakeQuads(Snake *snake, int cellSize, Position boardStart)
+{
+    // Draws the whole snake with one call from the vertex buffer, returns false if the snake has to be drawn a sprite at a time instead
+    SnakeRenderer *renderer = &snakeRenderer;
+    if (!renderer->ready || snake->tailIndex >= SNAKEQUADCAPACITY)
+        return false;
+    for (int i = 0; i <= snake->tailIndex; i++)
+    {
+        Cell *cell = snake->snakeSegments[i];
+        if (cell == NULL || cell->drawnFrame == boardDrawCount || cellContents(cell) != SNAKEBODY)
+            continue;
+        cell->drawnFrame = boardDrawCount; // Cells can be in the snake twice (the front entering the tails cell) but only have one slot
+        if (!updateSnakeSlot(cell))
+        {
+            boardDrawCount++; // Cells already marked as drawn this frame are drawn again by the sprite at a time fallback
+            return false;
+        }
+    }
 
-    // Food
-    FoodSprite = LoadTexture("resources/Food.png");
+    // Give back the slots of cells that have left the snake
+    for (int slot = 0; slot < renderer->slotCount; slot++)
+    {
+        SnakeQuadSlot *quads = &renderer->slots[slot];
+        if (quads->cell == NULL || quads->drawnFrame == boardDrawCount)
+            continue;
+        quads->cell = NULL;
+        memset(renderer->mesh.vertices + slot * SNAKESLOTVERTICES * 3, 0, SNAKESLOTVERTICES * 3 * sizeof(float));
+        uploadSnakeSlot(slot);
+        renderer->freeSlots[renderer->freeCount++] = slot;
+    }
+
+    float frame = snakeSpriteFrame;
+    SetShaderValue(renderer->material.shader, renderer->frameLocation, &frame, SHADER_UNIFORM_FLOAT);
+    Mesh mesh = renderer->mesh;
+    mesh.vertexCount = renderer->slotCount * SNAKESLOTVERTICES; // Slots past the last one handed out are never drawn
+    mesh.triangleCount = mesh.vertexCount / 3;
+    Matrix transform = {.m0 = cellSize, .m5 = cellSize, .m10 = 1.0f, .m15 = 1.0f, .m12 = boardStart.x, .m13 = boardStart.y}; // Cells to pixels
+    BeginShaderMode(renderer->material.shader); // Draws everything already batched (the background) before the snake
+    DrawMesh(mesh, renderer->material, transform);
+    EndShaderMode();
+    return true;
 }
-void LoadSounds()
+float particleRandom()
 {
-    ButtonClick = LoadSound("resources/Sounds/ButtonClick.wav");
-    StartGame = LoadSound("resources/Sounds/GameStart.wav");
-    WinGame = LoadSound("resources/Sounds/GameWin.wav");
-    SwitchScreen = LoadSound("resources/Sounds/SwitchScreen.wav");
-    SnakeEat = LoadSound("resources/Sounds/SnakeEat.wav");
-    SnakeDeath = LoadSound("resources/Sounds/SnakeDeath.wav");
+    // Returns a random number from 0 up to 1 (xorshift64)
+    particles.rng ^= particles.rng << 13;
+    particles.rng ^= particles.rng >> 7;
+    particles.rng ^= particles.rng << 17;
+    return (particles.rng >> 40) / 16777216.0f;
 }
-void initGame(Snake *snake, Cell board[boardSize][boardSize])
+void spawnParticles(Position cell, int count, int sprite, float speed)
 {
-    createBoard(board);
-    initSnake(snake, board);
-    generateFood(board, snake);
+    // Bursts 'count' particles out of the centre of 'cell' (as many as fit if the pool is nearly full)
+    ParticlePool *pool = &particles;
+    if (pool->x == NULL)
+        return;
+    if (count > PARTICLECAPACITY - pool->count)
+        count = PARTICLECAPACITY - pool->count;
+    if (count <= 0)
+        return;
+    if (pool->count < pool->dirtyFrom)
+        pool->dirtyFrom = pool->count;
+    for (int i = pool->count; i < pool->count + count; i++)
+    {
+        float angle = particleRandom() * 2.0f * PI;
+        float velocity = speed * (0.3f + 0.7f * particleRandom());
+        pool->x[i] = cell.x + 0.5f;
+        pool->y[i] = cell.y + 0.5f;
+        pool->vx[i] = cosf(angle) * velocity;
+        pool->vy[i] = sinf(angle) * velocity - speed * 0.5f; // Thrown upwards a little before they fall
+        pool->life[i] = 0.5f + 0.5f * particleRandom();
+        pool->shrink[i] = (0.2f + 0.3f * particleRandom()) / pool->life[i];
+        pool->sprite[i] = sprite;
+        pool->frame[i] = particleRandom() * 5.0f;
+    }
+    pool->count += count;
 }
-void initBoardSizes(int *cellSize, Position *boardStart)
+void moveParticles(int first, float frameTime)
 {
-    *cellSize = screenHeight / (boardSize);                            // Find the width and the height for each square on the board
-    int boardStartX = (screenWidth / 2) - (*cellSize * boardSize / 2); // Calculate where to start drawing the board
-    int boardStartY = (screenHeight - *cellSize * boardSize) / 2;      // Calculate where to start drawing the board
-    *boardStart = (Position){boardStartX, boardStartY};                // Store the board starting position
+    // Moves particles 'first' onwards along their velocity (and pulls them down) and takes 'frameTime' off their lives
+    ParticlePool *pool = &particles;
+    for (int i = first; i < pool->count; i++)
+    {
+        pool->x[i] += pool->vx[i] * frameTime;
+        pool->y[i] += pool->vy[i] * frameTime;
+        pool->vy[i] += PARTICLEGRAVITY * frameTime;
+        pool->life[i] -= frameTime;
+    }
 }
-void setDifficultySettings(int difficulty, float *snakeUpdateBaseInterval)
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) int moveParticlesAVX2(float frameTime)
 {
-    // Set the speed of the snake and the size of the board based on the users selected difficulty
-    if (difficulty == 0) // Easy
+    // Same as 'moveParticles' but 8 particles at a time, returns the first particle left for 'moveParticles'
+    ParticlePool *pool = &particles;
+    __m256 step = _mm256_set1_ps(frameTime);
+    __m256 fall = _mm256_set1_ps(PARTICLEGRAVITY * frameTime);
+    int i = 0;
+    for (; i + 8 <= pool->count; i += 8)
     {
-        boardSize = 6;
-        *snakeUpdateBaseInterval = 0.3f;
+        __m256 vy = _mm256_loadu_ps(pool->vy + i);
+        _mm256_storeu_ps(pool->x + i, _mm256_add_ps(_mm256_loadu_ps(pool->x + i), _mm256_mul_ps(_mm256_loadu_ps(pool->vx + i), step)));
+        _mm256_storeu_ps(pool->y + i, _mm256_add_ps(_mm256_loadu_ps(pool->y + i), _mm256_mul_ps(vy, step)));
+        _mm256_storeu_ps(pool->vy + i, _mm256_add_ps(vy, fall));
+        _mm256_storeu_ps(pool->life + i, _mm256_sub_ps(_mm256_loadu_ps(pool->life + i), step));
     }
-    // Medium
-    else if (difficulty == 1)
+    return i;
+}
+#endif
+void updateParticles(float frameTime)
+{
+    // Moves every particle and removes the ones that have run out of life
+    ParticlePool *pool = &particles;
+    if (pool->count == 0)
+        return;
+    double startTime = getSeconds();
+    int updated = pool->count;
+    detectAVX2();
+    int first = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpuHasAVX2)
+        first = moveParticlesAVX2(frameTime);
+#endif
+    moveParticles(first, frameTime);
+
+    // Fill the gaps left by dead particles with the particles from the end
+    for (int i = 0; i < pool->count;)
     {
-        boardSize = 8;
-        *snakeUpdateBaseInterval = 0.2f;
+        if (pool->life[i] > 0.0f)
+        {
+            i++;
+            continue;
+        }
+        int last = --pool->count;
+        pool->x[i] = pool->x[last];
+        pool->y[i] = pool->y[last];
+        pool->vx[i] = pool->vx[last];
+        pool->vy[i] = pool->vy[last];
+        pool->life[i] = pool->life[last];
+        pool->shrink[i] = pool->shrink[last];
+        pool->sprite[i] = pool->sprite[last];
+        pool->frame[i] = pool->frame[last];
+        if (i < pool->dirtyFrom)
+            pool->dirtyFrom = i;
     }
-    // Hard
-    else if (difficulty == 2)
+    pool->updateTime += getSeconds() - startTime;
+    pool->updated += updated;
+}
+void writeParticleQuads()
+{
+    // Writes the quads of the live particles into the particle mesh and uploads them (texture coordinates only from 'dirtyFrom')
+    ParticlePool *pool = &particles;
+    Mesh *mesh = &snakeRenderer.particleMesh;
+    static const float cornerX[PARTICLEVERTICES] = {-0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f}; // Same corners as the snake quads
+    static const float cornerY[PARTICLEVERTICES] = {-0.5f, 0.5f, 0.5f, -0.5f, 0.5f, -0.5f};
+    for (int i = 0; i < pool->count; i++)
     {
-        boardSize = 12;
-        *snakeUpdateBaseInterval = 0.15f;
+        float size = pool->life[i] * pool->shrink[i];
+        float *positions = mesh->vertices + i * PARTICLEVERTICES * 3;
+        for (int corner = 0; corner < PARTICLEVERTICES; corner++)
+        {
+            positions[corner * 3] = pool->x[i] + cornerX[corner] * size;
+            positions[corner * 3 + 1] = pool->y[i] + cornerY[corner] * size;
+            positions[corner * 3 + 2] = 0.0f;
+        }
     }
-    // Expert
-    else if (difficulty == 3)
+    UpdateMeshBuffer(*mesh, 0, mesh->vertices, pool->count * PARTICLEVERTICES * 3 * sizeof(float), 0);
+    if (pool->dirtyFrom >= pool->count)
+        return;
+
+    int rows[PARTICLESPRITES] = {FoodSprite.atlasRow, SnakeBodySprites.enteringCell.main.atlasRow};
+    for (int i = pool->dirtyFrom; i < pool->count; i++)
     {
-        boardSize = 14;
-        *snakeUpdateBaseInterval = 0.09f;
+        float *texcoords = mesh->texcoords + i * PARTICLEVERTICES * 2;
+        for (int corner = 0; corner < PARTICLEVERTICES; corner++)
+        {
+            texcoords[corner * 2] = pool->frame[i] + cornerX[corner] + 0.5f; // The frame is part of the coordinate so the 'frame' uniform is 0
+            texcoords[corner * 2 + 1] = (rows[pool->sprite[i]] + cornerY[corner] + 0.5f) / ASSETCOUNT;
+        }
     }
-    boardSize += 2; // add 2 to board size so there is space for walls
+    int offset = pool->dirtyFrom * PARTICLEVERTICES * 2;
+    UpdateMeshBuffer(*mesh, 1, mesh->texcoords + offset, (pool->count - pool->dirtyFrom) * PARTICLEVERTICES * 2 * sizeof(float), offset * sizeof(float));
+    pool->dirtyFrom = PARTICLECAPACITY;
 }
-
-void DrawStartScreen(Button *buttons[])
+void drawParticles(int cellSize, Position boardStart)
 {
-    // Start menu
-    DrawCenteredText("SNAKE", 40, 90, BLACK, screenWidth);
-
-    // Difficulty buttons
-    DrawButton(*buttons[0]);
-    DrawButton(*buttons[1]);
-    DrawButton(*buttons[2]);
-    DrawButton(*buttons[3]);
-
-    DrawCenteredText("PRESS [ENTER] TO START!", 480, 23, BLACK, screenWidth);
+    // Draws every particle on a board drawn at 'cellSize' from 'boardStart' (with one call once the sprite atlas is loaded)
+    ParticlePool *pool = &particles;
+    if (pool->count == 0)
+        return;
+    double startTime = getSeconds();
+    if (snakeRenderer.ready && FoodSprite.atlasRow != -1 && SnakeBodySprites.enteringCell.main.atlasRow != -1)
+    {
+        writeParticleQuads();
+        float frame = 0.0f;
+        SetShaderValue(snakeRenderer.material.shader, snakeRenderer.frameLocation, &frame, SHADER_UNIFORM_FLOAT);
+        Mesh mesh = snakeRenderer.particleMesh;
+        mesh.vertexCount = pool->count * PARTICLEVERTICES; // Slots past the live particles are never drawn
+        mesh.triangleCount = mesh.vertexCount / 3;
+        Matrix transform = {.m0 = cellSize, .m5 = cellSize, .m10 = 1.0f, .m15 = 1.0f, .m12 = boardStart.x, .m13 = boardStart.y}; // Cells to pixels
+        BeginShaderMode(snakeRenderer.material.shader); // Draws everything already batched before the particles
+        DrawMesh(mesh, snakeRenderer.material, transform);
+    }
+    else
+    {
+        Sprite sprites[PARTICLESPRITES] = {FoodSprite, SnakeBodySprites.enteringCell.main};
+        for (int i = 0; i < pool->count; i++)
+        {
+            Sprite sprite = sprites[pool->sprite[i]];
+            float size = pool->life[i] * pool->shrink[i] * cellSize;
+            Rectangle spriteSection = {sprite.texture.width / 5 * pool->frame[i], 0, sprite.texture.width / 5, sprite.texture.height};
+            Rectangle drawLocation = {boardStart.x + pool->x[i] * cellSize, boardStart.y + pool->y[i] * cellSize, size, size};
+            drawSpriteSection(sprite, spriteSection, drawLocation, (Vector2){size / 2, size / 2}, 0.0f);
+        }
+    }
+    EndShaderMode();
+    pool->drawTime += getSeconds() - startTime; // Time to build and hand over the quads (the GPU draws them after this returns)
+    pool->drawn += pool->count;
+    pool->drawCalls++;
 }
-void DrawBoard(Cell board[boardSize][boardSize], int cellSize, Position boardStart, Snake snake, int screenWidth, float snakeUpdateInterval, int difficulty, int currentFrame)
+void keepParticlesAlive()
+{
+    // Tops the pool up to 'benchmarkCount' particles with bursts from random cells of the board (for '--particles')
+    while (particles.count < particles.benchmarkCount && particles.count < PARTICLECAPACITY)
+    {
+        Position cell = {1 + particleRandom() * (boardSize - 2), 1 + particleRandom() * (boardSize - 2)};
+        spawnParticles(cell, EATPARTICLES, particleRandom() < 0.5f ? PARTICLEFOOD : PARTICLEBODY, 4.0f);
+    }
+}
+void freeParticles()
+{
+    gameFree(particles.x);
+    gameFree(particles.y);
+    gameFree(particles.vx);
+    gameFree(particles.vy);
+    gameFree(particles.life);
+    gameFree(particles.shrink);
+    gameFree(particles.sprite);
+    gameFree(particles.frame);
+    particles = (ParticlePool){0};
+}
+void printParticleCosts()
+{
+    // Prints the time spent on each particle updated and drawn (only if there were any)
+    ParticlePool *pool = &particles;
+    if (pool->updated == 0.0 || pool->drawn == 0.0)
+        return;
+    printf("Particles: update %.2f ns, draw %.2f ns per particle (%.0f live on average)\n", pool->updateTime / pool->updated * 1000000000.0,
+           pool->drawTime / pool->drawn * 1000000000.0, pool->drawn / pool->drawCalls);
+}
+void drawSnakeCell(Cell *cell, int cellSize, Position boardStart)
 {
-    // Help text
-    DrawText("[P] to pause.", 10, 10, 23, BLACK);
-    DrawText("[R] to restart.", 10, 40, 23, BLACK);
-    DrawText("[W], [A], [S], [D] /", 10, 80, 23, BLACK);
-    DrawText("[ARROW KEYS]", 10, 105, 23, BLACK);
-    DrawText("to move.", 10, 130, 23, BLACK);
+    // Draws the sprites of the part of the snake in 'cell'
+    int X = boardStart.x + cell->index.x * cellSize; // x coordinate for current cell
+    int Y = boardStart.y + cell->index.y * cellSize; // y coordinate for current cell
+    AnimateSprite(X, Y, cellSize, cell->spriteEnteringCell, cell->snakeSpriteDirection, snakeSpriteFrame);
+    AnimateSprite(X, Y, cellSize, cell->spriteLeavingCell, cell->snakeSpriteDirectionLeaving, snakeSpriteFrame);
 
-    // Game data
-    char scoreText[50];
-    sprintf(scoreText, "SCORE: %d", snake.tailIndex - 2);
-    int textWidth = MeasureText(scoreText, 35);
-    DrawText(scoreText, screenWidth - textWidth - 20, 20, 35, BLACK);
-    char difficultyText[50];
-    sprintf(difficultyText, "DIFFICULTY: %s", DifficultyToString(difficulty));
-    textWidth = MeasureText(difficultyText, 18);
-    DrawText(difficultyText, screenWidth - textWidth - 20, 55, 18, BLACK);
-
-    // Loop though all cells in the board drawing them
-    for (int i = 0; i < boardSize; i++)
+    if (cell->multipleLayers) // Snake mouth eat and close have multiple layers
     {
-        for (int j = 0; j < boardSize; j++)
+        AnimateSprite(X, Y, cellSize, cell->layer1, LEFT, snakeSpriteFrame); // Food doesnt rotate based on snakes direction
+        AnimateSprite(X, Y, cellSize, cell->layer2, cell->snakeSpriteDirection, snakeSpriteFrame);
+    }
+}
+void drawBoardScene(Cell board[boardSize][boardSize], int cellSize, Position boardStart, Snake snake, int viewWidth, int viewHeight, int currentFrame)
+{
+    // Draws the board, snake and food in the 'viewWidth' by 'viewHeight' pixels being drawn to
+    // Cells in view (everything else is skipped so drawing doesnt depend on the size of the board)
+    int firstX = -boardStart.x / cellSize > 0 ? -boardStart.x / cellSize : 0;
+    int firstY = -boardStart.y / cellSize > 0 ? -boardStart.y / cellSize : 0;
+    int lastX = (viewWidth - boardStart.x) / cellSize < boardSize - 1 ? (viewWidth - boardStart.x) / cellSize : boardSize - 1;
+    int lastY = (viewHeight - boardStart.y) / cellSize < boardSize - 1 ? (viewHeight - boardStart.y) / cellSize : boardSize - 1;
+
+    boardDrawCount++;
+    if (cellSize < LODCELLSIZE)
+    {
+        // Cells are too small to see the sprites so draw the whole board (snake and food included) as one texture
+        updateOverview();
+        DrawTextureEx(overview.texture, (Vector2){boardStart.x, boardStart.y}, 0.0f, cellSize, WHITE);
+    }
+    else
+    {
+        // Background from the cached chunks on the screen
+        int cells = chunkCells(cellSize);
+        for (int chunkX = firstX / cells; chunkX <= lastX / cells; chunkX++)
         {
-            int X = boardStart.x + i * cellSize; // x coordinate for current cell
-            int Y = boardStart.y + j * cellSize; // y coordinate for current cell
-
-            // Display cell with diffent colors depending on its contents
-            if (board[i][j].contents == BOARDWALL)
+            for (int chunkY = firstY / cells; chunkY <= lastY / cells; chunkY++)
             {
-                DrawRectangle(X, Y, cellSize, cellSize, DARKGRAY);
-                continue; // Skip to next cell
+                BoardChunk *chunk = getBoardChunk(chunkX, chunkY, cellSize, board);
+                float pixels = (float)chunk->texture.texture.width;
+                Vector2 position = {boardStart.x + chunkX * cells * cellSize, boardStart.y + chunkY * cells * cellSize};
+                if (snakeRenderer.ready)
+                    usePaletteShader(); // Chunks hold palette indices
+                DrawTextureRec(chunk->texture.texture, (Rectangle){0, 0, pixels, -pixels}, position, WHITE); // Render textures are stored upside down
             }
-            else
-            {
-                // Alternate between white and light gray for all cells that arent walls
-                if ((i + j) % 2 == 0)
-                    DrawRectangle(X, Y, cellSize, cellSize, LIGHTGRAY);
-                else
-                    DrawRectangle(X, Y, cellSize, cellSize, DARKERLIGHTGRAY);
+        }
 
-                if (board[i][j].contents == EMPTY)
-                    continue; // Skip to next cell
+        // Draw the snake (the head is included as it can be in the snake)
+        int visibleCells = (lastX - firstX + 1) * (lastY - firstY + 1);
+        bool snakeDrawn = drawSnakeQuads(&snake, cellSize, boardStart); // Whole snake in one call from the vertex buffer
+        if (!snakeDrawn && snake.tailIndex < visibleCells)
+        {
+            // Go through the segments of the snake instead of searching the screen for it
+            for (int i = 0; i <= snake.tailIndex; i++)
+            {
+                Cell *cell = snake.snakeSegments[i];
+                if (cell == NULL || cell->drawnFrame == boardDrawCount || cellContents(cell) != SNAKEBODY)
+                    continue;
+                cell->drawnFrame = boardDrawCount; // Cells can be in the snake twice (the front entering the tails cell) but are only drawn once
+                if (cell->index.x >= firstX && cell->index.x <= lastX && cell->index.y >= firstY && cell->index.y <= lastY)
+                    drawSnakeCell(cell, cellSize, boardStart);
             }
-
-            // Draw snake based on which part of the snake is in current cell
-            if (board[i][j].contents == SNAKEBODY)
+        }
+        else if (!snakeDrawn)
+        {
+            // The snake is longer than the number of cells on the screen so find its cells on the screen with the occupancy bitboard
+            for (int y = firstY; y <= lastY; y++)
             {
-                AnimateSprite(X, Y, cellSize, board[i][j].spriteEnteringCell, board[i][j].snakeSpriteDirection, snakeSpriteFrame);
-                AnimateSprite(X, Y, cellSize, board[i][j].spriteLeavingCell, board[i][j].snakeSpriteDirectionLeaving, snakeSpriteFrame);
-
-                if (board[i][j].multipleLayers) // Snake mouth eat and close have multiple layers
+                for (int x = firstX; x <= lastX; x += 64)
                 {
-                    AnimateSprite(X, Y, cellSize, board[i][j].layer1, LEFT, snakeSpriteFrame); // Food doesnt rotate based on snakes direction
-                    AnimateSprite(X, Y, cellSize, board[i][j].layer2, board[i][j].snakeSpriteDirection, snakeSpriteFrame);
+                    uint64_t bits = bitboardRowBits(occupancy.body, x, y);
+                    if (lastX - x < 63)
+                        bits &= ((uint64_t)1 << (lastX - x + 1)) - 1; // Only the columns on the screen
+                    while (bits != 0)
+                    {
+                        drawSnakeCell(&board[x + __builtin_ctzll(bits)][y], cellSize, boardStart);
+                        bits &= bits - 1;
+                    }
                 }
             }
-            if (board[i][j].contents == FOOD)
-            {
-                AnimateSprite(X, Y, cellSize, FoodSprite, 90, currentFrame);
-            }
         }
+
+        // Draw the food
+        if (cellContents(&board[foodPosition.x][foodPosition.y]) == FOOD)
+            AnimateSprite(boardStart.x + foodPosition.x * cellSize, boardStart.y + foodPosition.y * cellSize, cellSize, FoodSprite, 90, currentFrame);
     }
 
     // Draw the snake death animation over everything (the snake death animation is 2 cells wide)
@@ -678,37 +2948,84 @@ void DrawBoard(Cell board[boardSize][boardSize], int cellSize, Position boardSta
         int Y = boardStart.y + snake.snakeSegments[2]->index.y * cellSize;                                                        // y coordinate for current cell
         AnimateLongSprite(X, Y, cellSize, SnakeDeathSnakeSprite, snake.snakeSegments[2]->snakeSpriteDirection, snakeSpriteFrame); // When the snake dies to itself the animation overlaps two cells
     }
+    drawParticles(cellSize, boardStart);
+    EndShaderMode(); // Sprites and chunks may have left the palette shader in use
+}
+void DrawBoard(Cell board[boardSize][boardSize], int cellSize, Position boardStart, Snake snake, int screenWidth, float snakeUpdateInterval, int difficulty, int currentFrame)
+{
+    int boardScale = cellSize / ATLASFRAMESIZE;
+    if (cellSize % ATLASFRAMESIZE == 0 && boardScale >= 2)
+    {
+        // Sprites are scaled up by a whole number so draw the board with cells the size of the sprites and scale the whole thing up once.
+        // Every sprite pixel comes out the same size and the board only fills a fraction of the pixels
+        int width = screenWidth / boardScale + 1; // One extra pixel for the part of the view that starts between two board pixels
+        int height = screenHeight / boardScale + 1;
+        resizeRenderTarget(&boardTarget, width, height);
+        Position nativeStart; // Board start in the target (rounded up so the target starts on or just before the screen)
+        nativeStart.x = boardStart.x >= 0 ? (boardStart.x + boardScale - 1) / boardScale : -(-boardStart.x / boardScale);
+        nativeStart.y = boardStart.y >= 0 ? (boardStart.y + boardScale - 1) / boardScale : -(-boardStart.y / boardScale);
+        pushRenderTarget(&boardTarget);
+        ClearBackground(BLANK);
+        drawBoardScene(board, ATLASFRAMESIZE, nativeStart, snake, width, height, currentFrame);
+        popRenderTarget();
+        Rectangle view = {boardStart.x - nativeStart.x * boardScale, boardStart.y - nativeStart.y * boardScale, width * boardScale, height * boardScale};
+        DrawTexturePro(boardTarget.texture, (Rectangle){0, 0, width, -height}, view, (Vector2){0, 0}, 0.0f, WHITE); // Render textures are stored upside down
+    }
+    else
+        drawBoardScene(board, cellSize, boardStart, snake, screenWidth, screenHeight, currentFrame);
+    drawMinimap(cellSize, boardStart);
+
+    // Help text (drawn over the board as big boards fill the screen)
+    drawCachedText(HUDHELP, 0, 10, 10, TEXTLEFT, 23, BLACK, "[P] to pause.");
+    drawCachedText(HUDHELP + 1, 0, 10, 40, TEXTLEFT, 23, BLACK, "[R] to restart.");
+    drawCachedText(HUDHELP + 2, 0, 10, 80, TEXTLEFT, 23, BLACK, "[W], [A], [S], [D] /\n[ARROW KEYS]\nto move.");
+    drawCachedText(HUDHELP + 3, 0, 10, 170, TEXTLEFT, 23, BLACK, "[B] autopilot /\nsolver / MCTS.");
+    drawCachedText(HUDHELP + 4, 0, 10, 235, TEXTLEFT, 23, BLACK, "[F5] / [F9] to\nsave / load.");
+    drawCachedText(HUDHELP + 6, 0, 10, 365, TEXTLEFT, 23, BLACK, "[C] to change\nskin.");
+    int smallestCellSize, biggestCellSize;
+    getZoomLimits(&smallestCellSize, &biggestCellSize);
+    if (smallestCellSize < biggestCellSize) // Board can be zoomed
+        drawCachedText(HUDHELP + 5, 0, 10, 300, TEXTLEFT, 23, BLACK, "[-] / [=] or\n[WHEEL] to zoom.");
+
+    // Game data
+    drawCachedText(HUDSCORE, snake.tailIndex, screenWidth - 20, 20, TEXTRIGHT, 35, BLACK, "SCORE: %d", snake.tailIndex - 2);
+    drawCachedText(HUDDIFFICULTY, difficulty, screenWidth - 20, 55, TEXTRIGHT, 18, BLACK, "DIFFICULTY: %s", DifficultyToString(difficulty));
+    drawCachedText(HUDSKIN, currentSkin, screenWidth - 20, 105, TEXTRIGHT, 18, BLACK, "SKIN: %s", skins[currentSkin].name);
+
+    if (autopilotMode != AUTOPILOTOFF && autopilotMoveCount > 0)
+    {
+        // Show how long the autopilot takes to choose a move compared to the time between snake moves (remade once a move)
+        long long key = (long long)autopilotMoveCount * AUTOPILOTMODES + autopilotMode;
+        double averageTime = autopilotTime / autopilotMoveCount;
+        if (autopilotMode == MONTECARLO) // Uses all the time it is given so show how much searching it gets done instead
+            drawCachedText(HUDAUTOPILOT, key, screenWidth - 20, 80, TEXTRIGHT, 18, BLACK, "MCTS: %.0fK ROLLOUTS/S (%d THREADS)", mctsSearchTime > 0.0 ? mctsRollouts / mctsSearchTime / 1000.0 : 0.0, mctsBot != NULL ? mcts_thread_count(mctsBot) : 0);
+        else
+            drawCachedText(HUDAUTOPILOT, key, screenWidth - 20, 80, TEXTRIGHT, 18, BLACK, "%s: %.1f us (%.3f%% OF MOVE)", autopilotMode == HAMILTONIAN ? "SOLVER" : "AUTOPILOT", averageTime * 1000000.0, averageTime / snakeUpdateInterval * 100.0);
+    }
 }
 void DrawWinScreen(int difficulty)
 {
-    DrawCenteredText("YOU COMPLETED \n       SNAKE!", 150, 80, BLACK, screenWidth);
+    drawCachedText(HUDTITLE, WINSCREEN, screenWidth / 2, 150, TEXTCENTER, 80, BLACK, "YOU COMPLETED \n       SNAKE!");
     // Show the difficulty the user played on
-    char difficultyText[50];
-    sprintf(difficultyText, "ON %s DIFFICULTY", DifficultyToString(difficulty));
-    DrawCenteredText(difficultyText, 320, 35, BLACK, screenWidth);
+    drawCachedText(HUDMENUDIFFICULTY, difficulty, screenWidth / 2, 320, TEXTCENTER, 35, BLACK, "ON %s DIFFICULTY", DifficultyToString(difficulty));
 
-    DrawCenteredText("PRESS [ENTER] TO RE-START!", 440, 23, BLACK, screenWidth);
+    drawCachedText(HUDPROMPT, WINSCREEN, screenWidth / 2, 440, TEXTCENTER, 23, BLACK, "PRESS [ENTER] TO RE-START!");
 }
 void DrawDeathScreen(int difficulty)
 {
-    DrawCenteredText("YOU DIED!", 150, 130, BLACK, screenWidth);
+    drawCachedText(HUDTITLE, DEATHSCREEN, screenWidth / 2, 150, TEXTCENTER, 130, BLACK, "YOU DIED!");
     // Show the score the user achived
-    char scoreText[50];
-    sprintf(scoreText, "YOUR SCORE WAS: %d", scoreAchieved);
-    DrawCenteredText(scoreText, 290, 35, BLACK, screenWidth);
+    drawCachedText(HUDRESULT, scoreAchieved, screenWidth / 2, 290, TEXTCENTER, 35, BLACK, "YOUR SCORE WAS: %d", scoreAchieved);
     // Show the difficulty the user played on
-    char difficultyText[50];
-    sprintf(difficultyText, "ON %s DIFFICULTY", DifficultyToString(difficulty));
-    DrawCenteredText(difficultyText, 325, 35, BLACK, screenWidth);
-    DrawCenteredText("PRESS [ENTER] TO RE-START!", 440, 23, BLACK, screenWidth);
+    drawCachedText(HUDMENUDIFFICULTY, difficulty, screenWidth / 2, 325, TEXTCENTER, 35, BLACK, "ON %s DIFFICULTY", DifficultyToString(difficulty));
+    drawCachedText(HUDPROMPT, DEATHSCREEN, screenWidth / 2, 440, TEXTCENTER, 23, BLACK, "PRESS [ENTER] TO RE-START!");
 }
 
 void resetGame(Snake *snake, Cell board[boardSize][boardSize], int gameStateToGoTo)
 {
     // Reset all variables so game can be played again
     gameState = gameStateToGoTo;
-    cleanup(snake);
-    initGame(snake, board);
+    initGame(snake, board); // Keeps the snakes list of segments and the board from the last game
 }
 void resetTimeVariables(float *lastSnakeUpdateTime)
 {
@@ -723,20 +3040,200 @@ bool checkWin(Snake *snake, Cell board[boardSize][boardSize])
     if (numCellsToFill(snake, board) == 0) // If the snake has filled all the cells
     {
         PlaySound(WinGame);
+        for (int i = 0; i <= snake->tailIndex; i++) // Every part of the snake bursts (shown over the win screen)
+        {
+            if (snake->snakeSegments[i] != NULL)
+                spawnParticles(snake->snakeSegments[i]->index, WINPARTICLES, i % 2 == 0 ? PARTICLEFOOD : PARTICLEBODY, 6.0f);
+        }
+        if (autopilotMode == HAMILTONIAN) // Report how long the solver took to fill the board
+            printf("Solver filled a %dx%d board in %.2f seconds (%d moves, %.2f us per move)\n", boardSize - 2, boardSize - 2, GetTime() - autopilotStartTime, autopilotMoveCount, autopilotTime / autopilotMoveCount * 1000000.0);
         resetGame(snake, board, WINSCREEN); // Restart the game
         return true;
     }
     return false;
 }
 
+uint64_t hashPosition(Snake *snake)
+{
+    // Works out the hash of the current position from scratch (the same value 'positionHash' is kept at as the game is played)
+    // Snake cells are read from the bitboard as the front and the tail can share a cell while the tail is leaving it
+    uint64_t hash = zobristDirectionKey(snake->head.snakeDir);
+    for (int word = 0; word < occupancy.wordCount; word++)
+    {
+        for (uint64_t bits = occupancy.body[word]; bits != 0; bits &= bits - 1)
+            hash ^= zobristKey(word / occupancy.wordsPerRow * boardSize + (word % occupancy.wordsPerRow) * 64 + __builtin_ctzll(bits), SNAKEBODY);
+    }
+    if (bitboardTest(occupancy.food, foodPosition))
+        hash ^= zobristKey(foodPosition.y * boardSize + foodPosition.x, FOOD);
+    return hash;
+}
+size_t gameSnapshotSize()
+{
+    // Returns the most bytes a snapshot of a game on the current board can take (when the snake fills the board)
+    int bitboardWords = boardSize * ((boardSize + 63) / 64);
+    return sizeof(SnapshotHeader) + 3 * bitboardWords * sizeof(uint64_t) + (boardSize * boardSize + 1) * sizeof(SnapshotSegment);
+}
+size_t sessionMemorySize()
+{
+    // Returns the bytes needed by every per-session buffer when the board is the biggest it can be ('boardSize')
+    size_t cellCount = boardSize * boardSize;
+    size_t bitboardWords = boardSize * ((boardSize + 63) / 64);
+    size_t size = arenaBlockSize(cellCount * sizeof(Cell))                   // Board
+                  + arenaBlockSize(cellCount * sizeof(Cell *))               // Snake segments
+                  + arenaBlockSize(gameSnapshotSize())                       // Quick save
+                  + arenaBlockSize(cellCount * sizeof(int))                  // Snake cells passed to the Monte Carlo search
+                  + arenaBlockSize(3 * bitboardWords * sizeof(uint64_t))     // Occupancy bitboard
+                  + arenaBlockSize(2 * bitboardWords * sizeof(uint64_t))     // Flood fill layers
+                  + arenaBlockSize(cellCount * sizeof(Color))                // Board overview pixels
+                  + arenaBlockSize((boardSize + 63) / 64 * sizeof(uint64_t)) // Board overview dirty rows
+                  + 3 * arenaBlockSize(cellCount * sizeof(int))              // Distance field distances, queue and affected list
+                  + arenaBlockSize(cellCount * sizeof(DistanceSeed))         // Distance field seeds
+                  + arenaBlockSize(cellCount * sizeof(unsigned char))        // Distance field state
+                  + 6 * arenaBlockSize(PARTICLECAPACITY * sizeof(float))     // Particle positions, velocities, lives and sizes
+                  + 2 * arenaBlockSize(PARTICLECAPACITY);                    // Particle sprites and frames
+
+    // Hamiltonian cycles are built the first time each board size is played by the solver
+    for (int difficulty = 0; difficulty < 4; difficulty++)
+    {
+        int cycleSize = difficultyBoardSize(difficulty);
+        size += arenaBlockSize(cycleSize * cycleSize * sizeof(int));
+        if (customBoardSize != 0) // Every difficulty uses the same board
+            break;
+    }
+    return size;
+}
+void createSessionArena()
+{
+    // Allocates the session arena for the biggest board ('boardSize') and sizes the autopilot buffers for it
+    // so changing difficulty or starting a new game never has to allocate
+    sessionArena.size = sessionMemorySize();
+    sessionArena.base = (char *)calloc(1, sessionArena.size);
+    sessionArena.used = 0;
+    if (sessionArena.base == NULL)
+        sessionArena.size = 0; // Everything falls back to the heap (and is reported by 'checkAllocations')
+    resizeBitboard(&occupancy);
+    resizeDistanceField(&foodDistance);
+    resizeRegionFill();
+    resizeOverview();
+    particles.x = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.y = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.vx = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.vy = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.life = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.shrink = (float *)gameAlloc(PARTICLECAPACITY * sizeof(float));
+    particles.sprite = (unsigned char *)gameAlloc(PARTICLECAPACITY);
+    particles.frame = (unsigned char *)gameAlloc(PARTICLECAPACITY);
+}
+size_t saveGameSnapshot(Snake *snake, void *buffer)
+{
+    // Copies the state of the game into 'buffer' (at least 'gameSnapshotSize' bytes) without any pointers so it can be stored anywhere
+    // Sprites arent saved as they are chosen again from the snake every frame. Returns the number of bytes written
+    SnapshotHeader *header = (SnapshotHeader *)buffer;
+    header->boardSize = boardSize;
+    header->tailIndex = snake->tailIndex;
+    header->head = snake->head;
+    header->snakeMouthState = snakeMouthState;
+    header->tailPointDirection = tailPointDirection;
+    header->DeathType = DeathType;
+    header->gameState = gameState;
+    header->scoreAchieved = scoreAchieved;
+    header->foodPosition = foodPosition;
+    header->rngState = rngState;
+    header->gameTick = gameTick;
+    header->positionHash = positionHash;
+    header->bitboardWords = occupancy.wordCount;
+
+    uint64_t *bits = (uint64_t *)(header + 1);
+    memcpy(bits, occupancy.storage, 3 * occupancy.wordCount * sizeof(uint64_t));
+
+    SnapshotSegment *segments = (SnapshotSegment *)(bits + 3 * occupancy.wordCount);
+    for (int i = 0; i <= snake->tailIndex; i++)
+    {
+        Cell *segment = snake->snakeSegments[i];
+        if (segment == NULL)
+        {
+            segments[i] = (SnapshotSegment){-1, NOTSET, NOTSET};
+            continue;
+        }
+        segments[i].cell = segment->index.x * boardSize + segment->index.y;
+        segments[i].snakeSpriteDirection = segment->snakeSpriteDirection;
+        segments[i].snakeSpriteDirectionLeaving = segment->snakeSpriteDirectionLeaving;
+    }
+    return (char *)(segments + snake->tailIndex + 1) - (char *)buffer;
+}
+bool restoreGameSnapshot(Snake *snake, Cell board[boardSize][boardSize], const void *buffer)
+{
+    // Puts the game back into the state saved in 'buffer', returns false if the snapshot was taken on a different board size
+    // Only the cells used by the current and saved snake and food are touched so restoring doesnt depend on the size of the board
+    const SnapshotHeader *header = (const SnapshotHeader *)buffer;
+    if (header->boardSize != boardSize || header->bitboardWords != occupancy.wordCount)
+        return false;
+
+    // Clear the current snake and food from the board
+    for (int i = 1; i <= snake->tailIndex; i++)
+    {
+        if (snake->snakeSegments[i] != NULL)
+            snake->snakeSegments[i]->contents = EMPTY;
+    }
+    board[foodPosition.x][foodPosition.y].contents = EMPTY;
+
+    // Bring back the saved occupancy, snake and food
+    const uint64_t *bits = (const uint64_t *)(header + 1);
+    memcpy(occupancy.storage, bits, 3 * occupancy.wordCount * sizeof(uint64_t));
+    const SnapshotSegment *segments = (const SnapshotSegment *)(bits + 3 * occupancy.wordCount);
+    for (int i = 0; i <= header->tailIndex; i++)
+    {
+        if (segments[i].cell == -1)
+        {
+            snake->snakeSegments[i] = NULL;
+            continue;
+        }
+        Cell *segment = &board[segments[i].cell / boardSize][segments[i].cell % boardSize];
+        segment->snakeSpriteDirection = segments[i].snakeSpriteDirection;
+        segment->snakeSpriteDirectionLeaving = segments[i].snakeSpriteDirectionLeaving;
+        if (i != 0 && bitboardTest(occupancy.body, segment->index)) // Head isnt part of the snakes body
+        {
+            segment->contents = SNAKEBODY;
+            segment->generation = boardGeneration;
+        }
+        snake->snakeSegments[i] = segment;
+    }
+    for (int i = header->tailIndex + 1; i <= snake->tailIndex; i++)
+        snake->snakeSegments[i] = NULL; // Remove the rest of a longer snake
+    foodPosition = header->foodPosition;
+    if (bitboardTest(occupancy.food, foodPosition))
+    {
+        board[foodPosition.x][foodPosition.y].contents = FOOD;
+        board[foodPosition.x][foodPosition.y].generation = boardGeneration;
+    }
+
+    snake->tailIndex = header->tailIndex;
+    snake->head = header->head;
+    snakeMouthState = header->snakeMouthState;
+    tailPointDirection = header->tailPointDirection;
+    DeathType = header->DeathType;
+    gameState = header->gameState;
+    scoreAchieved = header->scoreAchieved;
+    rngState = header->rngState;
+    cycleOrderTick = UINT64_MAX; // Saved snake may not lie along the cycle
+    gameTick = header->gameTick;
+    positionHash = header->positionHash;
+    foodDistance.dirty = true; // Autopilot distances are rebuilt for the restored board
+    memset(overview.dirtyRows, 0xff, (boardSize + 63) / 64 * sizeof(uint64_t));
+    minimap.rebuild = true;
+    return true;
+}
+
 void menuInputs(bool *paused, Snake *snake, Cell board[boardSize][boardSize], float *lastSnakeUpdateTime)
 {
     if (IsKeyPressed(KEY_ENTER)) // Start game
     {
         if (gameState == STARTMENU) // If on start menu go to game when ENTER is hit
         {
+            waitForAssets(); // Sprites and sounds are needed from here on
             PlaySound(StartGame);
             resetTimeVariables(lastSnakeUpdateTime);
+            resetAutopilotStats();
             gameState = GAME;
         }
         else if (gameState == WINSCREEN || gameState == DEATHSCREEN) // If on win or death screen go to start menu when ENTER is hit
@@ -750,6 +3247,29 @@ void menuInputs(bool *paused, Snake *snake, Cell board[boardSize][boardSize], fl
     {
         PlaySound(SwitchScreen);
         *paused = !(*paused); // Toggle Pause
+        if (*paused && mctsBot != NULL) // Dont keep every core busy while paused (the search starts again when the game carries on)
+            mcts_stop(mctsBot, NULL);
+    }
+    if (IsKeyPressed(KEY_B)) // Switch between the player, the autopilot, the solver and the Monte Carlo autopilot
+    {
+        PlaySound(SwitchScreen);
+        autopilotMode = (autopilotMode + 1) % AUTOPILOTMODES;
+        resetAutopilotStats();
+    }
+    if (IsKeyPressed(KEY_F5) && gameState == GAME) // Quick save
+    {
+        PlaySound(ButtonClick);
+        saveGameSnapshot(snake, quickSave);
+    }
+    if (IsKeyPressed(KEY_F9) && gameState == GAME && restoreGameSnapshot(snake, board, quickSave)) // Quick load (only if the save was made on this board size)
+    {
+        PlaySound(ButtonClick);
+        resetTimeVariables(lastSnakeUpdateTime);
+    }
+    if (IsKeyPressed(KEY_C)) // Change the skin of the snake and the colours of the board
+    {
+        PlaySound(ButtonClick);
+        setSkin((currentSkin + 1) % SKINCOUNT);
     }
     if (IsKeyPressed(KEY_R)) // Reset game
     {
@@ -841,6 +3361,302 @@ void playerInputs(Snake *snake, Cell board[boardSize][boardSize])
     }
 }
 
+int oppositeDirection(int Dir)
+{
+    // Returns the direction that would make the snake go back on itself
+    if (Dir == UP)
+        return DOWN;
+    else if (Dir == DOWN)
+        return UP;
+    else if (Dir == LEFT)
+        return RIGHT;
+    return LEFT;
+}
+int countFreeNeighbours(Position pos)
+{
+    // Returns how many of the cells directly adjacent to 'pos' are free
+    int freeCount = 0;
+    for (int Dir = UP; Dir <= RIGHT; Dir++)
+    {
+        if (!isCellBlocked(getNextCellFromDir(pos, Dir)))
+            freeCount++;
+    }
+    return freeCount;
+}
+int choosePathfinderDirection(Snake *snake)
+{
+    // Chooses the direction for the next snake move by following the distance field down to the food
+    if (foodDistance.dirty)
+        rebuildDistanceField(&foodDistance);
+
+    Position snakeFrontPos = snake->head.snakeFront;
+    Cell *tail = snake->snakeSegments[snake->tailIndex - 1]; // NULL while the snake is lengthening (the tail wont move this snake move)
+    Position tailPos = tail != NULL ? tail->index : snake->snakeSegments[snake->tailIndex - 2]->index;
+    int bestDirection = NOTSET;
+    int bestDistance = UNREACHABLE;
+    int bestRegionSize = -1;
+    int bestFreeNeighbours = -1;
+    int fallbackDirection = NOTSET;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int Dir = (snake->head.snakeDir + i) % 4; // Start with the current direction so the snake only turns when it needs to
+        if (Dir == oppositeDirection(snake->head.snakeDir))
+            continue;
+
+        Position nextPos = getNextCellFromDir(snakeFrontPos, Dir);
+        bool isTail = tail != NULL && tail->index.x == nextPos.x && tail->index.y == nextPos.y; // The tail leaves its cell as the front enters it
+        if (isCellBlocked(nextPos) && !isTail)
+            continue;
+
+        int distance = foodDistance.distance[nextPos.y * boardSize + nextPos.x];
+        if (isTail) // Tail cells arent part of the field so find the distance from its free neighbours
+        {
+            distance = UNREACHABLE;
+            for (int j = UP; j <= RIGHT; j++)
+            {
+                Position neighbour = getNextCellFromDir(nextPos, j);
+                if (!isCellBlocked(neighbour) && foodDistance.distance[neighbour.y * boardSize + neighbour.x] + 1 < distance)
+                    distance = foodDistance.distance[neighbour.y * boardSize + neighbour.x] + 1;
+            }
+        }
+
+        // Only head for the food through regions the snake fits in (or can follow its tail out of)
+        RegionInfo region = floodFillRegion(nextPos, tailPos);
+        bool roomy = region.reachesTail || region.size >= snake->tailIndex - 1;
+        if (roomy && distance < bestDistance)
+        {
+            bestDistance = distance;
+            bestDirection = Dir;
+        }
+
+        // If the food cant be reached keep to the move with the most room around it
+        int freeNeighbours = countFreeNeighbours(nextPos);
+        if (region.size > bestRegionSize || (region.size == bestRegionSize && freeNeighbours > bestFreeNeighbours))
+        {
+            bestRegionSize = region.size;
+            bestFreeNeighbours = freeNeighbours;
+            fallbackDirection = Dir;
+        }
+    }
+
+    if (bestDirection == NOTSET)
+        bestDirection = fallbackDirection;
+    return bestDirection;
+}
+HamiltonianCycle *getHamiltonianCycle()
+{
+    // Returns the cycle for the current board size, building it the first time the size is used
+    // Returns NULL if the playable board has an odd width (no cycle can visit every cell)
+    int playableSize = boardSize - 2;
+    if (playableSize % 2 != 0)
+        return NULL;
+
+    for (int i = 0; i < CYCLECACHESIZE; i++)
+    {
+        if (cycleCache[i].boardSize == boardSize)
+            return &cycleCache[i];
+    }
+
+    HamiltonianCycle *cycle = &cycleCache[nextCycleCacheSlot];
+    nextCycleCacheSlot = (nextCycleCacheSlot + 1) % CYCLECACHESIZE;
+    gameFree(cycle->order);
+    cycle->order = (int *)gameAlloc(boardSize * boardSize * sizeof(int));
+    cycle->boardSize = boardSize;
+    for (int i = 0; i < boardSize * boardSize; i++)
+        cycle->order[i] = -1;
+
+    // Zig-zag along the rows leaving the first column free, then return up the first column
+    int step = 0;
+    for (int y = 1; y <= playableSize; y++)
+    {
+        for (int i = 0; i < playableSize - 1; i++)
+        {
+            int x = (y % 2 == 1) ? 2 + i : playableSize - i; // Odd rows go right and even rows go left
+            cycle->order[y * boardSize + x] = step++;
+        }
+    }
+    for (int y = playableSize; y >= 1; y--)
+        cycle->order[y * boardSize + 1] = step++;
+
+    // The snake starts facing left in the middle row so the cycle has to go left along that row
+    if ((boardSize / 2) % 2 == 1)
+    {
+        int cellCount = playableSize * playableSize;
+        for (int i = 0; i < boardSize * boardSize; i++)
+        {
+            if (cycle->order[i] != -1)
+                cycle->order[i] = cellCount - 1 - cycle->order[i]; // Go round the cycle the other way
+        }
+    }
+    return cycle;
+}
+void freeHamiltonianCycles()
+{
+    for (int i = 0; i < CYCLECACHESIZE; i++)
+    {
+        gameFree(cycleCache[i].order);
+        cycleCache[i] = (HamiltonianCycle){0};
+    }
+}
+int snakeEnvBody(Snake *snake, int *body, int *lengthening)
+{
+    // Writes the snake cells from the tail to the front as snakeenv cell indices (the cell the tail is leaving is left out if the front has moved into it)
+    // Returns the length of the snake and sets 'lengthening' to 1 if the snake has just eaten so its tail stays still for the next move
+    int tail = snake->tailIndex - 1;
+    *lengthening = 0;
+    if (snake->snakeSegments[tail] == NULL) // Snake has just eaten
+    {
+        tail--;
+        *lengthening = 1;
+    }
+    int length = 0;
+    for (int i = tail; i >= 1; i--)
+    {
+        if (snake->snakeSegments[i] != NULL && (i == 1 || snake->snakeSegments[i] != snake->snakeSegments[1]))
+            body[length++] = snake->snakeSegments[i]->index.y * boardSize + snake->snakeSegments[i]->index.x;
+    }
+    return length;
+}
+int snakeEnvFoodCell()
+{
+    // Returns the snakeenv cell index of the food (-1 if there is none)
+    return bitboardTest(occupancy.food, foodPosition) ? foodPosition.y * boardSize + foodPosition.x : -1;
+}
+bool isSnakeAlongCycle(Snake *snake, HamiltonianCycle *cycle)
+{
+    // Returns true if the snake lies along the cycle in order from its tail to its front (so the cells ahead of the front up to the tail are free)
+    int cellCount = (boardSize - 2) * (boardSize - 2);
+    int lengthening;
+    int length = snakeEnvBody(snake, mctsBody, &lengthening);
+    int tailOrder = cycle->order[mctsBody[0]];
+    int lastGap = 0;
+    for (int i = 1; i < length; i++)
+    {
+        int gap = (cycle->order[mctsBody[i]] - tailOrder + cellCount) % cellCount;
+        if (gap <= lastGap)
+            return false;
+        lastGap = gap;
+    }
+    return true;
+}
+int chooseHamiltonianDirection(Snake *snake)
+{
+    // Follows the Hamiltonian cycle, cutting ahead along it towards the food while that cant trap the snake
+    // The snake always fills the cycle in order from tail to front so the cells ahead of the front up to the tail are free
+    HamiltonianCycle *cycle = getHamiltonianCycle();
+    if (cycle == NULL)
+        return choosePathfinderDirection(snake); // No cycle exists on this board so fall back to the pathfinder
+
+    // The solver can take over a snake that doesnt lie along the cycle (switched to mid-game or after a quick load)
+    // It follows the cycle without cutting ahead until the snake does, which takes a snake length of moves
+    bool alongCycle = cycleOrderTick == gameTick || isSnakeAlongCycle(snake, cycle); // Only checked again once someone else has moved the snake
+    int cellCount = (boardSize - 2) * (boardSize - 2);
+    Position snakeFrontPos = snake->head.snakeFront;
+    Cell *tail = snake->snakeSegments[snake->tailIndex - 1];
+    bool lengthening = tail == NULL; // Tail stays where it is for this move
+    if (lengthening)
+        tail = snake->snakeSegments[snake->tailIndex - 2];
+    int snakeLength = snake->tailIndex - 1; // Cells the snake will fill once it has finished lengthening
+
+    int frontOrder = cycle->order[snakeFrontPos.y * boardSize + snakeFrontPos.x];
+    int tailGap = (cycle->order[tail->index.y * boardSize + tail->index.x] - frontOrder + cellCount) % cellCount; // Steps along the cycle to the tail
+    int foodGap = (cycle->order[foodPosition.y * boardSize + foodPosition.x] - frontOrder + cellCount) % cellCount;
+    bool shortcutsAllowed = alongCycle && snakeLength < cellCount / 2; // Once the snake fills half the board it only follows the cycle
+
+    int cycleDirection = NOTSET;
+    int bestDirection = NOTSET;
+    int bestGap = 0;
+    for (int Dir = UP; Dir <= RIGHT; Dir++)
+    {
+        Position nextPos = getNextCellFromDir(snakeFrontPos, Dir);
+        int nextOrder = cycle->order[nextPos.y * boardSize + nextPos.x];
+        if (nextOrder == -1) // Wall
+            continue;
+        bool isTail = !lengthening && tail->index.x == nextPos.x && tail->index.y == nextPos.y;
+        if (isCellBlocked(nextPos) && !isTail)
+            continue;
+
+        int gap = (nextOrder - frontOrder + cellCount) % cellCount;
+        if (gap == 1)
+            cycleDirection = Dir;
+
+        // Only skip ahead to cells before the food and leave enough room before the tail for the snake to grow
+        if (shortcutsAllowed && gap <= foodGap && gap < tailGap - 3 && gap > bestGap)
+        {
+            bestGap = gap;
+            bestDirection = Dir;
+        }
+    }
+
+    if (bestDirection == NOTSET)
+        bestDirection = cycleDirection;
+    if (bestDirection == NOTSET) // Next cell along the cycle is part of a snake that doesnt lie along it yet
+        return choosePathfinderDirection(snake);
+    cycleOrderTick = alongCycle ? gameTick + 1 : UINT64_MAX; // Moves along the cycle keep the snake in order
+    return bestDirection;
+}
+bool searchMonteCarlo(Snake *snake, double moveDeadline, int *direction)
+{
+    // Keeps a Monte Carlo search of the current position running in the background while frames are drawn
+    // Returns true with the chosen direction once the next frame could be drawn after the snake has moved
+    if (mctsBot == NULL)
+        mctsBot = mcts_create(mctsThreadCount);
+    if (mctsBot == NULL) // Threads couldnt be started
+    {
+        *direction = choosePathfinderDirection(snake);
+        return true;
+    }
+
+    if (!mcts_is_searching(mctsBot) || mctsSearchTick != gameTick || mctsSearchHash != positionHash)
+    {
+        int lengthening;
+        int length = snakeEnvBody(snake, mctsBody, &lengthening);
+        MctsPosition position = {boardSize - 2, mctsBody, length, snake->head.snakeDir, snakeEnvFoodCell(), lengthening, snake->tailIndex - 2};
+        mcts_start(mctsBot, &position);
+        mctsSearchTick = gameTick;
+        mctsSearchHash = positionHash;
+    }
+    if (GetTime() + GetFrameTime() * 1.5 < moveDeadline) // There is time for another frame before the snake moves
+        return false;
+
+    MctsStats stats;
+    *direction = mcts_stop(mctsBot, &stats);
+    if (*direction == ENV_NOACTION) // Every move loses (directions in snakeenv are the same as the game)
+        *direction = NOTSET;
+    mctsRollouts += stats.rollouts;
+    mctsSearchTime += stats.seconds;
+    return true;
+}
+void autopilotInputs(Snake *snake, Cell board[boardSize][boardSize], double moveDeadline)
+{
+    // Chooses the direction for the next snake move
+    // Works the same way as 'playerInputs' by setting 'headDir' and moving the head to the chosen cell
+    if (snake->head.headDir != NOTSET) // Move for this snake move cycle has already been chosen
+        return;
+
+    double startTime = GetTime();
+    int direction;
+    if (autopilotMode == MONTECARLO)
+    {
+        if (!searchMonteCarlo(snake, moveDeadline, &direction)) // Still searching
+            return;
+    }
+    else if (autopilotMode == HAMILTONIAN)
+        direction = chooseHamiltonianDirection(snake);
+    else
+        direction = choosePathfinderDirection(snake);
+    if (direction == NOTSET) // Snake is trapped so it carries on in the same direction
+        direction = snake->head.snakeDir;
+
+    snake->head.headDir = direction;
+    Position newSnakeHeadPos = getNextCellFromDir(snake->head.snakeFront, direction);
+    snake->snakeSegments[0] = &board[newSnakeHeadPos.x][newSnakeHeadPos.y]; // Set the head pointer to its new board cell
+
+    autopilotTime += GetTime() - startTime;
+    autopilotMoveCount++;
+}
+
 void SetSnakesMouthState()
 {
     // Updates snake mouth state based on previous mouth state (updates every snake move)
@@ -852,22 +3668,30 @@ void SetSnakesMouthState()
 void CheckSnakeDeath(Snake *snake)
 {
     // If snake has hit a wall or itself
-    if (snake->snakeSegments[0]->contents == SNAKEBODY || snake->snakeSegments[0]->contents == BOARDWALL)
+    if (isCellBlocked(snake->snakeSegments[0]->index))
     {
         if (snake->snakeSegments[0] != snake->snakeSegments[snake->tailIndex - 2] && snake->snakeSegments[0] != snake->snakeSegments[snake->tailIndex - 1]) // Dont end the game if the head is about to bite the tail that will be removed
         {
             PlaySound(SnakeDeath);
+            if (mctsBot != NULL) // Nothing left to search for
+                mcts_stop(mctsBot, NULL);
+            for (int i = 0; i <= snake->tailIndex; i++) // The snake falls apart
+            {
+                if (snake->snakeSegments[i] != NULL)
+                    spawnParticles(snake->snakeSegments[i]->index, DEATHPARTICLES, PARTICLEBODY, 3.0f);
+            }
             scoreAchieved = snake->tailIndex - 2;          // Calculate score from snakes length
             gameState = DEATHANIMATION;                    // Set to display snake dying
-            DeathType = snake->snakeSegments[0]->contents; // Death type equals the contents of the cell the snake hit (BOARDWALL or SNAKEBODY)
+            DeathType = cellContents(snake->snakeSegments[0]); // Death type equals the contents of the cell the snake hit (BOARDWALL or SNAKEBODY)
         }
     }
 }
 void CheckSnakeEat(Snake *snake, Cell board[boardSize][boardSize])
 {
-    if (snake->snakeSegments[0]->contents == FOOD) // Snake has eaten food
+    if (bitboardTest(occupancy.food, snake->snakeSegments[0]->index)) // Snake has eaten food
     {
         PlaySound(SnakeEat);
+        spawnParticles(snake->snakeSegments[0]->index, EATPARTICLES, PARTICLEFOOD, 4.0f);
         snake->tailIndex++; // Increse length by one
         if (checkWin(snake, board))
             return; // Doesnt continue if player has won
@@ -875,7 +3699,7 @@ void CheckSnakeEat(Snake *snake, Cell board[boardSize][boardSize])
             generateFood(board, snake); // Create new food in random vaild location
         snakeMouthState = EATING;       // Set mouth to eating
     }
-    if (isAdjacentToFood(snake->snakeSegments[1], board) && snakeMouthState != EATING) // If near food open mouth ready to eat or close
+    if (isAdjacentToFood(snake->snakeSegments[1]) && snakeMouthState != EATING) // If near food open mouth ready to eat or close
         snakeMouthState = OPENING;
 }
 void ChooseMouthSprite(Snake *snake)
@@ -910,6 +3734,61 @@ void setAnimationFrame(float lastSnakeUpdateTime, float snakeUpdateInterval)
     if (snakeSpriteFrame > 4 && gameState != DEATHANIMATION) // Dont reset to frame 0 if displaying the snakes death animation (so the game knows when the death animation is over)
         snakeSpriteFrame = 0;
 }
+void createRulesEnvs()
+{
+    // Creates the snakeenv rules for every board that can be played so checking moves doesnt allocate while playing
+    for (int difficulty = 0; difficulty < 4; difficulty++)
+    {
+        EnvConfig config = env_default_config(difficultyBoardSize(difficulty) - 2);
+        rulesEnvs[difficulty] = env_create(&config);
+        rulesEnvSizes[difficulty] = rulesEnvs[difficulty] != NULL ? difficultyBoardSize(difficulty) : 0;
+        if (customBoardSize != 0) // Every difficulty uses the same board
+            break;
+    }
+}
+void startRulesCheck(Snake *snake)
+{
+    // Plays the move the game is about to make with the rules in snakeenv so 'finishRulesCheck' can compare them once the game has moved
+    // Also checks the hash kept up to date as the game is played (the board is only fully updated for the last move by now)
+    uint64_t hash = hashPosition(snake);
+    if (hash != positionHash)
+        printf("Warning: the position hash is %016llx before move %llu but %016llx worked out from scratch\n", (unsigned long long)positionHash, (unsigned long long)gameTick,
+               (unsigned long long)hash);
+    rulesEnv = NULL;
+    for (int i = 0; i < 4; i++)
+    {
+        if (rulesEnvSizes[i] == boardSize)
+            rulesEnv = rulesEnvs[i];
+    }
+    if (rulesEnv == NULL)
+        return;
+    int lengthening;
+    int length = snakeEnvBody(snake, mctsBody, &lengthening);
+    if (!env_load(rulesEnv, mctsBody, length, snake->head.snakeDir, snakeEnvFoodCell(), lengthening, snake->tailIndex - 2))
+    {
+        printf("Warning: snakeenv couldnt load the position before move %llu\n", (unsigned long long)gameTick);
+        rulesEnv = NULL;
+        return;
+    }
+    float reward;
+    env_step(rulesEnv, snake->head.headDir, &reward, &rulesDone); // Turning back on itself is ignored by snakeenv the same way as by the inputs
+}
+void finishRulesCheck(Snake *snake)
+{
+    // Reports any difference between the move the game has made and the same move played with the rules in snakeenv
+    if (rulesEnv == NULL)
+        return;
+    const char *outcomes[] = {"moved", "died", "won"};
+    int gameOutcome = gameState == DEATHANIMATION ? 1 : gameState == WINSCREEN ? 2 : 0;
+    int envOutcome = env_won(rulesEnv) ? 2 : rulesDone ? 1 : 0;
+    int envFront = env_front_cell(rulesEnv);
+    if (gameOutcome != envOutcome)
+        printf("Warning: the snake %s on move %llu but %s with the rules in snakeenv\n", outcomes[gameOutcome], (unsigned long long)gameTick, outcomes[envOutcome]);
+    else if (gameOutcome == 0 && (env_score(rulesEnv) != snake->tailIndex - 2 || envFront != snake->snakeSegments[1]->index.y * boardSize + snake->snakeSegments[1]->index.x))
+        printf("Warning: the snake is at (%d, %d) with a score of %d after move %llu but at (%d, %d) with a score of %d with the rules in snakeenv\n", snake->snakeSegments[1]->index.x,
+               snake->snakeSegments[1]->index.y, snake->tailIndex - 2, (unsigned long long)gameTick, envFront % boardSize, envFront / boardSize, env_score(rulesEnv));
+    rulesEnv = NULL;
+}
 void moveSnake(float *lastSnakeUpdateTime, float snakeUpdateBaseInterval, float *snakeUpdateInterval, float speedIncreasePerSegement, Cell board[boardSize][boardSize], Snake *snake)
 {
     float currentTime = GetTime();                                                                        // Get the current time since the program started
@@ -918,10 +3797,16 @@ void moveSnake(float *lastSnakeUpdateTime, float snakeUpdateBaseInterval, float
     // check if it is time to move the snake
     if (currentTime - (*lastSnakeUpdateTime + totalPausedTime) >= *snakeUpdateInterval) // Add pause time to last update time to account for time spent in pause menu
     {
+        gameTick++;
         SetSnakesMouthState(); // Update mouth state
+        if (checkRules) // Play the same move with the rules in snakeenv to compare once the game has moved
+            startRulesCheck(snake);
 
-        if (snake->head.headDir != NOTSET)              // If the user has inputed a new direction for the snake (snake needs to turn this move)
+        if (snake->head.headDir != NOTSET) // If the user has inputed a new direction for the snake (snake needs to turn this move)
+        {
+            positionHash ^= zobristDirectionKey(snake->head.snakeDir) ^ zobristDirectionKey(snake->head.headDir);
             snake->head.snakeDir = snake->head.headDir; // Set head state so snake cant move back on itself next move
+        }
 
         // If snake has hit a wall or itself
         CheckSnakeDeath(snake);
@@ -935,7 +3820,7 @@ void moveSnake(float *lastSnakeUpdateTime, float snakeUpdateBaseInterval, float
         if (snake->snakeSegments[snake->tailIndex] != NULL)
         {
             tailPointDirection = snake->snakeSegments[snake->tailIndex]->snakeSpriteDirectionLeaving; // Store the direction the tail is pointing in
-            snake->snakeSegments[snake->tailIndex]->contents = EMPTY;                                 // Set last body section of the snake to empty on the board (Removing the tail)
+            setCellContents(snake->snakeSegments[snake->tailIndex], EMPTY);                           // Set last body section of the snake to empty on the board (Removing the tail)
             snake->snakeSegments[snake->tailIndex] = NULL;                                            // Remove last body section of the snake (tail) moving the snake and keeping the length constant
         }
         // Checks if the snake is on a food cell and sets the mouth state to opening if adjecent to food cell
@@ -951,6 +3836,8 @@ void moveSnake(float *lastSnakeUpdateTime, float snakeUpdateBaseInterval, float
 
         snake->head.headDir = snake->head.headDirBuffer; // Set the direction for next move to what is in the buffer (usually 'NOTSET')
         snake->head.headDirBuffer = NOTSET;              // Reset the buffer
+        if (checkRules)
+            finishRulesCheck(snake);
 
         *lastSnakeUpdateTime = currentTime - totalPausedTime; // Set the last update time
     }
@@ -969,7 +3856,8 @@ void updateBoardForSnake(Snake *snake)
     {
         if (snake->snakeSegments[i] != NULL) // Only modify segments that are currently part of the snake
         {
-            snake->snakeSegments[i]->contents = SNAKEBODY;                             // Set the refrenced board cell to display the snake body segment
+            if (cellContents(snake->snakeSegments[i]) != SNAKEBODY)                    // Only touch the bitboard for cells the snake has just entered
+                setCellContents(snake->snakeSegments[i], SNAKEBODY);                   // Set the refrenced board cell to display the snake body segment
             snake->snakeSegments[i]->multipleLayers = false;                           // Reset to false by default (only set to true when drawing snake mouth eating and closing)
             SetEnteringAndLeavingSprite(SnakeBodySprites, SnakeBodySprites, snake, i); // Set the entering and leaving cell sprite to snake body with correct turn direction
         }
@@ -1004,9 +3892,37 @@ void updateBoardForSnake(Snake *snake)
     }
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
-    srand(time(0)); // Use current time to seed random number generator
+    startupTimes.start = getSeconds();
+    startAssetDecoding(); // Decode the sprites and sounds on other threads while the game and window are set up
+    rngState = time(0); // Use current time to seed random number generator
+
+    // Command line options
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--autopilot") == 0) // Start with the autopilot playing the game
+            autopilotMode = PATHFINDER;
+        else if (strcmp(argv[i], "--solver") == 0) // Start with the Hamiltonian cycle solver playing the game
+            autopilotMode = HAMILTONIAN;
+        else if (strcmp(argv[i], "--mcts") == 0) // Start with the Monte Carlo tree search autopilot playing the game
+            autopilotMode = MONTECARLO;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) // Threads for the Monte Carlo autopilot
+            mctsThreadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) // Custom playable board size
+            customBoardSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) // Keep this many particles alive while playing (prints their cost at exit)
+            particles.benchmarkCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--check-rules") == 0) // Play every move again with the rules in snakeenv and report any difference
+            checkRules = true;
+    }
+    if (customBoardSize != 0 && customBoardSize < 6)
+    {
+        printf("Board size must be at least 6, using the difficulty board size instead\n");
+        customBoardSize = 0;
+    }
+    if (checkRules)
+        createRulesEnvs();
 
     int difficulty = 1;                           // Store difficulty level (0-3) (default to medium: 1)
     const int buttonStartPosX = 250;              // How far fron the left the difficulty buttons start
@@ -1018,18 +3934,25 @@ int main(void)
     Button *buttons[] = {&buttonEasy, &buttonMedium, &buttonHard, &buttonExpert}; // Create a list of the buttons
     const int buttonCount = 4;                                                    // Number of buttons (used for for loops)
 
-    bool paused = false;              // Is game paused
-    boardSize = 16;                   // Size of the playable board (set to 16 witch is the biggest possible on expert difficulty)
-    boardSize += 2;                   // Add 2 to board size so there is space for walls
-    Cell board[boardSize][boardSize]; // Create a 2d array with the size of the biggest possible board
+    bool paused = false; // Is game paused
+    boardSize = 16;      // Size of the playable board (set to 16 witch is the biggest possible on expert difficulty)
+    if (customBoardSize > boardSize)
+        boardSize = customBoardSize;
+    boardSize += 2;                                                            // Add 2 to board size so there is space for walls
+    createSessionArena();                                                      // Allocate all the memory a session needs up front
+    Cell(*board)[boardSize] = gameAlloc(boardSize * boardSize * sizeof(Cell)); // Create a 2d array with the size of the biggest possible board (custom boards can be large)
+    quickSave = gameAlloc(gameSnapshotSize());                                 // Space for a snapshot on the biggest possible board
+    mctsBody = gameAlloc(boardSize * boardSize * sizeof(int));                 // Space for the biggest snake
 
     int cellSize;        // Store the width and the height for each square on the board
     Position boardStart; // Store where to start drawing the board
 
     Snake snake;
-    snake.snakeSegments = NULL;
+    snake.snakeSegments = gameAlloc(boardSize * boardSize * sizeof(Cell *)); // Space for the biggest snake (reused by every game)
+    snake.segmentCapacity = boardSize * boardSize;
+    snake.tailIndex = 0;
     float snakeUpdateBaseInterval;           // Base speed without speed increses when snake lengthens
-    float snakeUpdateInterval;               // Current speed of the snake ('snakeUpdateBaseInterval' + snake length * 'speedIncreasePerSegement')
+    float snakeUpdateInterval = 0.0f;        // Current speed of the snake ('snakeUpdateBaseInterval' + snake length * 'speedIncreasePerSegement')
     float speedIncreasePerSegement = 0.001f; // How much the snake should speed up per segement
     float lastSnakeUpdateTime = 0.0f;        // Time since last snake movement
 
@@ -1042,19 +3965,25 @@ int main(void)
     initGame(&snake, board);                                     // Initialise the snake
 
     // init main window
-    InitWindow(screenWidth, screenHeight, "Snake"); // Start window
-    InitAudioDevice();                              // Start audio
-    SetTargetFPS(60);
-
-    LoadSprites(); // Load animation sprites
-    LoadSounds();  // Load sound
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_WINDOW_HIGHDPI);  // The frame is scaled to fit whatever size the window is made
+    InitWindow(screenWidth, screenHeight, "Snake");              // Start window (audio and sprites are loaded once the start menu is showing)
+    SetWindowMinSize(screenWidth / 4, screenHeight / 4);
+    screenTarget = LoadRenderTexture(screenWidth, screenHeight); // Every frame is drawn at 'screenWidth' by 'screenHeight' whatever the size of the window
+    startupTimes.window = getSeconds();
+    SetTargetFPS(FULLFPS);
+    checkedAllocationCount = atomic_load(&heapAllocationCount); // Only allocations made while the game is running are reported
 
     while (!WindowShouldClose())
     {
-        framesCounter++; // Count frames for animations
+        paceFrames(paused);
+        framesCounter += FULLFPS / pacing.fps; // Count frames for animations (frames at a lower frame rate count as several)
+        if (!paused)
+            updateParticles(GetFrameTime());
+        if (gameState == GAME && !paused)
+            keepParticlesAlive();
 
         // Increase current frame if more than x amount of frames have elapsed
-        if (framesCounter >= (60 / framesSpeed))
+        if (framesCounter >= (FULLFPS / framesSpeed))
         {
             framesCounter = 0; // Reset frame counter
             currentFrame++;    // Increase animation frame
@@ -1064,6 +3993,7 @@ int main(void)
         }
 
         BeginDrawing();
+        pushRenderTarget(&screenTarget);
         ClearBackground(RAYWHITE); // Clear screen
 
         // Get menu keyboard inputs (start game, pause, resart)
@@ -1074,19 +4004,24 @@ int main(void)
         {
             if (!paused) // If not paused run game
             {
-                playerInputs(&snake, board);                                                                                             // Direction inputs
+                if (autopilotMode != AUTOPILOTOFF)                                                                                       // Let the autopilot choose the direction
+                    autopilotInputs(&snake, board, lastSnakeUpdateTime + totalPausedTime + snakeUpdateInterval);                         // Autopilot inputs (given the time the snake next moves)
+                else
+                    playerInputs(&snake, board);                                                                                         // Direction inputs
                 setAnimationFrame(lastSnakeUpdateTime, snakeUpdateInterval);                                                             // Update the animation frame the snakeis on
                 moveSnake(&lastSnakeUpdateTime, snakeUpdateBaseInterval, &snakeUpdateInterval, speedIncreasePerSegement, board, &snake); // Move snake at intervals based on snake speed
                 updateBoardForSnake(&snake);                                                                                             // Modify the boards cells to store information about the snake
             }
 
             // Draw game board
+            zoomInputs(&cellSize);                       // Zoom the camera in or out
+            updateCamera(&snake, cellSize, &boardStart); // Follow the snake on boards bigger than the screen
             DrawBoard(board, cellSize, boardStart, snake, screenWidth, snakeUpdateInterval, difficulty, currentFrame);
             if (paused)
             {
                 // Show game is paused
                 DrawRectangle(0, 0, screenWidth, screenHeight, (Color){0, 0, 0, 50}); // Semi-transparent black covering the whole screen
-                DrawCenteredText("PAUSED!", screenHeight / 2, 23, WHITE, screenWidth);
+                drawCachedText(HUDPAUSED, 0, screenWidth / 2, screenHeight / 2, TEXTCENTER, 23, WHITE, "PAUSED!");
             }
         }
         else if (gameState == DEATHANIMATION) // For the next move after the snake dies display death animation
@@ -1094,6 +4029,7 @@ int main(void)
             setAnimationFrame(lastSnakeUpdateTime, snakeUpdateInterval); // Keep updating the animation frame for the death animation
             if (snakeSpriteFrame > 4)                                    // Once animation has completed switch to death screen
                 resetGame(&snake, board, DEATHSCREEN);
+            updateCamera(&snake, cellSize, &boardStart);
             DrawBoard(board, cellSize, boardStart, snake, screenWidth, snakeUpdateInterval, difficulty, currentFrame); // Draw board
         }
         else if (gameState == STARTMENU) // If not started draw start screen
@@ -1105,16 +4041,50 @@ int main(void)
         else if (gameState == WINSCREEN)
         {
             DrawWinScreen(difficulty);
+            drawParticles(cellSize, boardStart); // Burst from the snake that filled the board
         }
         else if (gameState == DEATHSCREEN) // After death animation draw death screen
         {
             DrawDeathScreen(difficulty);
+            drawParticles(cellSize, boardStart); // Rest of the snake falling apart
         }
 
+        popRenderTarget();
+        presentScreen(); // Scale the frame up to the window
         EndDrawing();
+        if (startupTimes.firstFrame == 0.0)
+            startupTimes.firstFrame = getSeconds();
+        if (loadAssets(ASSETFRAMEBUDGET) && !startupTimes.printed) // Stream in sprites and sounds between frames
+            printStartupTimes();
+        checkAllocations(); // Nothing should be allocated while playing or starting a new game
+        recordFrameTime(paused);
     }
+    printCpuUse();
+    printParticleCosts();
+
     // clear up and shut down
+    finishAssetDecoding();     // Asset threads may still be running if the window was closed straight away
+    bundle_close(assetBundle); // Still mapped if the assets never finished loading
     cleanup(&snake);
+    freeBitboard(&occupancy);
+    freeDistanceField(&foodDistance);
+    gameFree(regionFill.region); // Also frees the 'open' layer
+    freeHamiltonianCycles();
+    gameFree(board);
+    gameFree(quickSave);
+    mcts_destroy(mctsBot);
+    for (int i = 0; i < 4; i++)
+        env_destroy(rulesEnvs[i]);
+    gameFree(mctsBody);
+    freeParticles();
+    free(sessionArena.base);
+    unloadBoardChunks();
+    unloadOverview();
+    unloadMinimap();
+    unloadSnakeRenderer();
+    unloadHudText();
+    UnloadRenderTexture(boardTarget);
+    UnloadRenderTexture(screenTarget);
     CloseAudioDevice();
     CloseWindow();
     return 0;
@@ -0,0 +1,147 @@
+#include "snakebundle.h"
+#include "raylib.h" // GetPixelDataSize
+#include <stdlib.h> // malloc
+#include <string.h> // strncmp
+#ifdef _WIN32
+#include <windows.h> // CreateFileMapping/MapViewOfFile
+#else
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+#endif
+
+struct Bundle
+{
+    const unsigned char *base; // Start of the mapped file
+    size_t size;               // Bytes mapped
+    const BundleHeader *header;
+    const BundleEntry *entries;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+static bool isEntryValid(const BundleEntry *entry)
+{
+    // Checks the entry has a kind the game knows and holds at least as many bytes as its fields say raylib will read
+    if (entry->kind == BUNDLE_IMAGE)
+    {
+        // At most 4 million pixels so GetPixelDataSize cant overflow working out the bits of the widest format
+        if (entry->width == 0 || entry->height == 0 || (uint64_t)entry->width * entry->height > (1u << 22) || entry->format < PIXELFORMAT_UNCOMPRESSED_GRAYSCALE ||
+            entry->format > PIXELFORMAT_COMPRESSED_ASTC_8x8_RGBA)
+            return false;
+        int pixelBytes = GetPixelDataSize(entry->width, entry->height, entry->format);
+        return pixelBytes > 0 && entry->size >= (uint64_t)pixelBytes;
+    }
+    if (entry->kind == BUNDLE_WAVE)
+    {
+        if (entry->frameCount == 0 || entry->sampleRate == 0 || entry->channels == 0 || entry->channels > 2 ||
+            (entry->sampleSize != 8 && entry->sampleSize != 16 && entry->sampleSize != 32))
+            return false;
+        return entry->size >= (uint64_t)entry->frameCount * entry->channels * (entry->sampleSize / 8);
+    }
+    return false;
+}
+static bool isValid(const Bundle *bundle)
+{
+    // Checks the header and that every entry is inside the file and as big as its fields say so a damaged bundle cant be read past its end
+    const BundleHeader *header = bundle->header;
+    if (bundle->size < sizeof(BundleHeader) || header->magic != BUNDLE_MAGIC || header->version != BUNDLE_VERSION || header->totalSize != bundle->size)
+        return false;
+    if (header->entryCount > (bundle->size - sizeof(BundleHeader)) / sizeof(BundleEntry))
+        return false;
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        const BundleEntry *entry = &bundle->entries[i];
+        if (entry->offset > bundle->size || entry->size > bundle->size - entry->offset || memchr(entry->name, 0, BUNDLE_NAME_LENGTH) == NULL || !isEntryValid(entry))
+            return false;
+    }
+    return true;
+}
+
+Bundle *bundle_open(const char *path)
+{
+    Bundle *bundle = (Bundle *)calloc(1, sizeof(Bundle));
+    if (bundle == NULL)
+        return NULL;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER fileSize;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        free(bundle);
+        return NULL;
+    }
+    bundle->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file); // The mapping keeps the file open
+    if (bundle->mapping != NULL)
+        bundle->base = (const unsigned char *)MapViewOfFile(bundle->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (bundle->base == NULL)
+    {
+        if (bundle->mapping != NULL)
+            CloseHandle(bundle->mapping);
+        free(bundle);
+        return NULL;
+    }
+    bundle->size = (size_t)fileSize.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat fileInfo;
+    if (fd < 0 || fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        free(bundle);
+        return NULL;
+    }
+    void *region = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (region == MAP_FAILED)
+    {
+        free(bundle);
+        return NULL;
+    }
+    bundle->base = (const unsigned char *)region;
+    bundle->size = fileInfo.st_size;
+#endif
+
+    bundle->header = (const BundleHeader *)bundle->base;
+    bundle->entries = (const BundleEntry *)(bundle->base + sizeof(BundleHeader));
+    if (!isValid(bundle))
+    {
+        bundle_close(bundle);
+        return NULL;
+    }
+    return bundle;
+}
+void bundle_close(Bundle *bundle)
+{
+    if (bundle == NULL)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(bundle->base);
+    CloseHandle(bundle->mapping);
+#else
+    munmap((void *)bundle->base, bundle->size);
+#endif
+    free(bundle);
+}
+
+const BundleEntry *bundle_find(const Bundle *bundle, const char *name)
+{
+    // Entries are only looked up once each at startup so a linear search is fine
+    for (uint32_t i = 0; i < bundle->header->entryCount; i++)
+    {
+        if (strncmp(bundle->entries[i].name, name, BUNDLE_NAME_LENGTH) == 0)
+            return &bundle->entries[i];
+    }
+    return NULL;
+}
+const void *bundle_data(const Bundle *bundle, const BundleEntry *entry)
+{
+    return bundle->base + entry->offset;
+}
@@ -0,0 +1,55 @@
+// Single file holding every sprite and sound of the game already decoded (built from the resources folder by snakepack)
+// The game maps the file into memory at startup so sprites are uploaded straight from the mapping without opening or decoding
+// any other files, and every running copy of the game shares the same pages of the file
+// Layout: BundleHeader, 'entryCount' BundleEntry, then the data of each entry (each starting on its own cache line)
+#ifndef SNAKEBUNDLE_H
+#define SNAKEBUNDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUNDLE_MAGIC 0x454c444e55424b53ull // "SKBUNDLE"
+#define BUNDLE_VERSION 1
+#define BUNDLE_DEFAULT_NAME "resources.bundle"
+#define BUNDLE_NAME_LENGTH 96 // Longest file name (including the terminating 0)
+#define BUNDLE_ALIGNMENT 64   // Data of each entry starts on a multiple of this
+
+// Entry kinds
+#define BUNDLE_IMAGE 1 // Pixels in the raylib pixel format 'format' (snakepack stores 8 bit RGBA)
+#define BUNDLE_WAVE 2  // Interleaved PCM samples
+
+typedef struct
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t totalSize; // Size of the whole file in bytes
+} BundleHeader;
+
+typedef struct
+{
+    char name[BUNDLE_NAME_LENGTH]; // Path of the file the entry was made from (for example "resources/Food.png")
+    uint32_t kind;                 // BUNDLE_IMAGE or BUNDLE_WAVE
+    uint32_t width;                // Images: size in pixels and raylib pixel format
+    uint32_t height;
+    uint32_t format;
+    uint32_t frameCount; // Waves: same fields as a raylib Wave
+    uint32_t sampleRate;
+    uint32_t sampleSize;
+    uint32_t channels;
+    uint64_t offset; // Offset in bytes of the data from the start of the file
+    uint64_t size;   // Bytes of data
+} BundleEntry;
+
+typedef struct Bundle Bundle;
+
+// Maps the bundle at 'path' into memory, returns NULL if it doesnt exist or isnt a valid bundle
+Bundle *bundle_open(const char *path);
+void bundle_close(Bundle *bundle); // Unmaps the bundle (data returned by 'bundle_data' cant be used after this)
+
+// Returns the entry made from the file 'name' (NULL if the bundle doesnt have it)
+const BundleEntry *bundle_find(const Bundle *bundle, const char *name);
+const void *bundle_data(const Bundle *bundle, const BundleEntry *entry);
+
+#endif
@@ -0,0 +1,443 @@
+#include "snakeenv.h"
+#include <stdlib.h> // malloc/abs
+#include <string.h> // memset
+
+// Board contents (same as snake.c)
+#define EMPTY 0
+#define BOARDWALL 1
+#define SNAKEBODY 2
+#define FOOD 3
+
+struct SnakeEnv
+{
+    EnvConfig config;
+    int boardSize;        // Width and height of the board including the walls
+    int cellCount;        // boardSize * boardSize
+    int playableCells;    // Number of cells inside the walls
+    uint8_t *contents;    // Contents of every cell (indexed by y * boardSize + x)
+    uint8_t *marks;       // Cells already seen while checking a position for env_load (all 0 between calls)
+    int *body;            // Ring buffer of the cells the snake is in (from the tail to the front)
+    int bodyTail;         // Index in 'body' of the tail
+    int length;           // Number of cells the snake is in
+    int lengthening;      // Moves left where the tail stays still because the snake has eaten
+    int direction;        // Direction the snake last moved in
+    int foodCell;         // Cell containing the food (-1 if there is none)
+    int score;            // Same as the score in the game
+    int stepsWithoutFood; // Steps since the snake last ate
+    uint64_t tick;        // Steps taken this episode
+    uint64_t rngState;    // Random number generator state for placing food
+    bool done;
+    bool won;
+};
+
+static uint64_t nextRandom(uint64_t *state)
+{
+    // splitmix64 (any seed including 0 gives a good sequence)
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static int frontCell(const SnakeEnv *env)
+{
+    return env->body[(env->bodyTail + env->length - 1) % env->playableCells];
+}
+static int cellInDirection(const SnakeEnv *env, int cell, int direction)
+{
+    // Returns the index of the cell next to 'cell' in 'direction'
+    if (direction == ENV_UP)
+        return cell - env->boardSize;
+    else if (direction == ENV_DOWN)
+        return cell + env->boardSize;
+    else if (direction == ENV_LEFT)
+        return cell - 1;
+    return cell + 1;
+}
+static bool isOpposite(int direction1, int direction2)
+{
+    // UP/DOWN and LEFT/RIGHT only differ in their lowest bit
+    return (direction1 ^ direction2) == 1;
+}
+
+static void setObservation(SnakeEnv *env, int plane, int cell, uint8_t value)
+{
+    if (env->config.observation != NULL)
+        env->config.observation[plane * env->cellCount + cell] = value;
+}
+static void setContents(SnakeEnv *env, int cell, int contents)
+{
+    // Sets the contents of a cell and keeps the walls, body and food planes of the observation in step
+    int previousContents = env->contents[cell];
+    env->contents[cell] = contents;
+    if (previousContents == SNAKEBODY)
+        setObservation(env, ENV_PLANE_BODY, cell, 0);
+    else if (previousContents == FOOD)
+        setObservation(env, ENV_PLANE_FOOD, cell, 0);
+
+    if (contents == SNAKEBODY)
+        setObservation(env, ENV_PLANE_BODY, cell, 1);
+    else if (contents == FOOD)
+        setObservation(env, ENV_PLANE_FOOD, cell, 1);
+    else if (contents == BOARDWALL)
+        setObservation(env, ENV_PLANE_WALLS, cell, 1);
+}
+
+static void placeFood(SnakeEnv *env, int excludedCell)
+{
+    // Places food on a random empty cell (avoiding 'excludedCell' unless it is the only empty cell)
+    int freeCount = env->playableCells - env->length;
+    env->foodCell = -1;
+    if (freeCount <= 0)
+        return;
+
+    int cell;
+    if (freeCount > env->cellCount / 8)
+    {
+        // Keep guessing cells until an empty one is found
+        do
+        {
+            cell = nextRandom(&env->rngState) % env->cellCount;
+        } while (env->contents[cell] != EMPTY || (cell == excludedCell && freeCount > 1));
+    }
+    else
+    {
+        // Nearly full board so pick one of the empty cells directly
+        do
+        {
+            int n = nextRandom(&env->rngState) % freeCount;
+            for (cell = 0; cell < env->cellCount; cell++)
+            {
+                if (env->contents[cell] == EMPTY && n-- == 0)
+                    break;
+            }
+        } while (cell == excludedCell && freeCount > 1);
+    }
+    env->foodCell = cell;
+    setContents(env, cell, FOOD);
+}
+
+EnvConfig env_default_config(int boardSize)
+{
+    EnvConfig config = {0};
+    config.boardSize = boardSize;
+    config.observation = NULL;
+    config.foodReward = 1.0f;
+    config.deathReward = -1.0f;
+    config.winReward = 10.0f;
+    config.stepReward = 0.0f;
+    config.maxStepsWithoutFood = 0;
+    return config;
+}
+size_t env_observation_size(int boardSize)
+{
+    return (size_t)ENV_PLANE_COUNT * (boardSize + 2) * (boardSize + 2);
+}
+
+SnakeEnv *env_create(const EnvConfig *config)
+{
+    if (config == NULL || config->boardSize < 6) // Same smallest board as the game (the snake needs room to start in the middle)
+        return NULL;
+
+    int boardSize = config->boardSize + 2; // Add 2 to board size so there is space for walls
+    int cellCount = boardSize * boardSize;
+    int playableCells = config->boardSize * config->boardSize;
+
+    // One allocation for the environment, the board contents, the marks and the snake
+    size_t bodyOffset = (sizeof(SnakeEnv) + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+    size_t contentsOffset = bodyOffset + playableCells * sizeof(int);
+    SnakeEnv *env = (SnakeEnv *)malloc(contentsOffset + 2 * (size_t)cellCount);
+    if (env == NULL)
+        return NULL;
+
+    memset(env, 0, sizeof(SnakeEnv));
+    memset((char *)env + contentsOffset + cellCount, 0, cellCount); // Marks
+    env->config = *config;
+    env->boardSize = boardSize;
+    env->cellCount = cellCount;
+    env->playableCells = playableCells;
+    env->body = (int *)((char *)env + bodyOffset);
+    env->contents = (uint8_t *)env + contentsOffset;
+    env->marks = env->contents + cellCount;
+    env_reset(env, 0);
+    return env;
+}
+void env_destroy(SnakeEnv *env)
+{
+    free(env);
+}
+
+void env_reset(SnakeEnv *env, uint64_t seed)
+{
+    int boardSize = env->boardSize;
+    if (env->config.observation != NULL)
+        memset(env->config.observation, 0, env_observation_size(env->config.boardSize));
+
+    // Empty board with walls all around it
+    memset(env->contents, EMPTY, env->cellCount);
+    for (int y = 0; y < boardSize; y++)
+    {
+        for (int x = 0; x < boardSize; x++)
+        {
+            if (x == 0 || y == 0 || x == boardSize - 1 || y == boardSize - 1)
+                setContents(env, y * boardSize + x, BOARDWALL);
+        }
+    }
+
+    // Snake starts in the middle of the board facing left with a length of 3 (added from the tail to the front)
+    int front = (boardSize / 2) * boardSize + boardSize / 2;
+    env->bodyTail = 0;
+    env->length = 3;
+    for (int i = 0; i < 3; i++)
+    {
+        env->body[i] = front + 2 - i;
+        setContents(env, front + 2 - i, SNAKEBODY);
+    }
+    setObservation(env, ENV_PLANE_HEAD, front, 1);
+
+    env->lengthening = 0;
+    env->direction = ENV_LEFT;
+    env->score = 2;
+    env->stepsWithoutFood = 0;
+    env->tick = 0;
+    env->rngState = seed;
+    env->done = false;
+    env->won = false;
+    placeFood(env, front - 1); // Dont put the food directly in front of the snake
+}
+
+static bool isPlayableCell(const SnakeEnv *env, int cell)
+{
+    // Cell is on the board and inside the walls
+    int x = cell % env->boardSize;
+    int y = cell / env->boardSize;
+    return cell >= 0 && cell < env->cellCount && x > 0 && y > 0 && x < env->boardSize - 1 && y < env->boardSize - 1;
+}
+static bool isLoadablePosition(SnakeEnv *env, const int *body, int length, int direction, int foodCell, int lengthening)
+{
+    // Checks a position for env_load without changing the environment (only 'marks' is used, and it is cleared again before returning)
+    if (length < 1 || length > env->playableCells || direction < ENV_UP || direction > ENV_RIGHT || lengthening < 0)
+        return false;
+    if (foodCell != -1 && !isPlayableCell(env, foodCell))
+        return false;
+    bool valid = true;
+    int marked = 0;
+    for (; marked < length; marked++)
+    {
+        int cell = body[marked];
+        if (!isPlayableCell(env, cell) || env->marks[cell] || cell == foodCell) // Off the board, in the snake twice or under the food
+        {
+            valid = false;
+            break;
+        }
+        if (marked > 0 && abs(cell - body[marked - 1]) != 1 && abs(cell - body[marked - 1]) != env->boardSize) // Not next to the cell before it
+        {
+            valid = false;
+            break;
+        }
+        env->marks[cell] = 1;
+    }
+    for (int i = 0; i < marked; i++)
+        env->marks[body[i]] = 0;
+    return valid;
+}
+bool env_load(SnakeEnv *env, const int *body, int length, int direction, int foodCell, int lengthening, int score)
+{
+    if (!isLoadablePosition(env, body, length, direction, foodCell, lengthening))
+        return false;
+
+    // Take the current snake and food off the board (the walls stay where they are)
+    for (int i = 0; i < env->length; i++)
+        setContents(env, env->body[(env->bodyTail + i) % env->playableCells], EMPTY);
+    setObservation(env, ENV_PLANE_HEAD, frontCell(env), 0);
+    if (env->foodCell != -1)
+        setContents(env, env->foodCell, EMPTY);
+
+    for (int i = 0; i < length; i++)
+    {
+        env->body[i] = body[i];
+        setContents(env, body[i], SNAKEBODY);
+    }
+    env->bodyTail = 0;
+    env->length = length;
+    setObservation(env, ENV_PLANE_HEAD, body[length - 1], 1);
+    env->foodCell = foodCell;
+    if (foodCell != -1)
+        setContents(env, foodCell, FOOD);
+    env->lengthening = lengthening;
+    env->direction = direction;
+    env->score = score;
+    env->done = false;
+    env->won = false;
+    return true;
+}
+void env_set_seed(SnakeEnv *env, uint64_t seed)
+{
+    env->rngState = seed;
+}
+
+void env_step(SnakeEnv *env, int action, float *reward, bool *done)
+{
+    EnvUndo undo;
+    env_make_move(env, action, &undo, reward, done);
+}
+void env_make_move(SnakeEnv *env, int action, EnvUndo *undo, float *reward, bool *done)
+{
+    undo->direction = env->direction;
+    undo->enteredCell = -1;
+    undo->vacatedCell = -1;
+    undo->eatenCell = -1;
+    undo->placedFoodCell = -1;
+    undo->lengthening = env->lengthening;
+    undo->stepsWithoutFood = env->stepsWithoutFood;
+    undo->rngState = env->rngState;
+    undo->done = env->done;
+    undo->won = env->won;
+
+    *reward = 0.0f;
+    if (env->done)
+    {
+        *done = true;
+        return;
+    }
+
+    // Ignore actions that would make the snake go back on itself (same as the players inputs)
+    if (action >= ENV_UP && action <= ENV_RIGHT && !isOpposite(action, env->direction))
+        env->direction = action;
+
+    int front = frontCell(env);
+    int next = cellInDirection(env, front, env->direction);
+    int tail = env->body[env->bodyTail];
+    bool tailMoves = env->lengthening == 0; // Tail stays still for the move after the snake eats
+    env->tick++;
+    *reward = env->config.stepReward;
+
+    // If snake has hit a wall or itself (moving into the cell the tail is leaving is allowed)
+    if (env->contents[next] == BOARDWALL || (env->contents[next] == SNAKEBODY && !(next == tail && tailMoves)))
+    {
+        *reward += env->config.deathReward;
+        env->done = true;
+        *done = true;
+        return;
+    }
+
+    // Move the tail
+    if (tailMoves)
+    {
+        undo->vacatedCell = tail;
+        setContents(env, tail, EMPTY);
+        env->bodyTail = (env->bodyTail + 1) % env->playableCells;
+        env->length--;
+    }
+    else
+        env->lengthening--;
+
+    // Move the front
+    bool eating = next == env->foodCell;
+    undo->enteredCell = next;
+    env->body[(env->bodyTail + env->length) % env->playableCells] = next;
+    env->length++;
+    setContents(env, next, SNAKEBODY);
+    setObservation(env, ENV_PLANE_HEAD, front, 0);
+    setObservation(env, ENV_PLANE_HEAD, next, 1);
+
+    if (eating)
+    {
+        undo->eatenCell = next;
+        env->score++;
+        env->lengthening++;
+        env->stepsWithoutFood = 0;
+        *reward += env->config.foodReward;
+        placeFood(env, -1);
+        undo->placedFoodCell = env->foodCell;
+        if (env->foodCell == -1) // Nowhere left to put food so the snake has filled the board
+        {
+            *reward += env->config.winReward;
+            env->won = true;
+            env->done = true;
+        }
+    }
+    else if (env->config.maxStepsWithoutFood != 0 && ++env->stepsWithoutFood >= env->config.maxStepsWithoutFood)
+        env->done = true; // Stop episodes where the snake is going round in circles
+
+    *done = env->done;
+}
+void env_unmake_move(SnakeEnv *env, const EnvUndo *undo)
+{
+    if (undo->done) // Environment had already finished so the move didnt change anything
+        return;
+    env->tick--;
+
+    if (undo->enteredCell != -1)
+    {
+        // Take the new food off the board first as it could be in the cell the tail left
+        if (undo->placedFoodCell != -1)
+            setContents(env, undo->placedFoodCell, EMPTY);
+
+        // Move the front back
+        setContents(env, undo->enteredCell, EMPTY);
+        setObservation(env, ENV_PLANE_HEAD, undo->enteredCell, 0);
+        env->length--;
+        setObservation(env, ENV_PLANE_HEAD, frontCell(env), 1);
+
+        // Move the tail back (after the front in case the front had moved into the cell the tail left)
+        if (undo->vacatedCell != -1)
+        {
+            env->bodyTail = (env->bodyTail + env->playableCells - 1) % env->playableCells;
+            env->body[env->bodyTail] = undo->vacatedCell;
+            env->length++;
+            setContents(env, undo->vacatedCell, SNAKEBODY);
+        }
+
+        // Put the eaten food back
+        if (undo->eatenCell != -1)
+        {
+            env->score--;
+            env->foodCell = undo->eatenCell;
+            setContents(env, undo->eatenCell, FOOD);
+        }
+    }
+
+    env->direction = undo->direction;
+    env->lengthening = undo->lengthening;
+    env->stepsWithoutFood = undo->stepsWithoutFood;
+    env->rngState = undo->rngState;
+    env->done = undo->done;
+    env->won = undo->won;
+}
+
+int env_score(const SnakeEnv *env)
+{
+    return env->score;
+}
+int env_direction(const SnakeEnv *env)
+{
+    return env->direction;
+}
+bool env_won(const SnakeEnv *env)
+{
+    return env->won;
+}
+uint64_t env_tick(const SnakeEnv *env)
+{
+    return env->tick;
+}
+int env_front_cell(const SnakeEnv *env)
+{
+    return frontCell(env);
+}
+int env_food_cell(const SnakeEnv *env)
+{
+    return env->foodCell;
+}
+bool env_is_deadly(const SnakeEnv *env, int action)
+{
+    // Same checks as env_make_move without moving the snake
+    int direction = env->direction;
+    if (action >= ENV_UP && action <= ENV_RIGHT && !isOpposite(action, direction))
+        direction = action;
+    int next = cellInDirection(env, frontCell(env), direction);
+    if (env->contents[next] == BOARDWALL)
+        return true;
+    return env->contents[next] == SNAKEBODY && !(next == env->body[env->bodyTail] && env->lengthening == 0);
+}
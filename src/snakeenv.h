@@ -0,0 +1,89 @@
+// Headless snake environment for training agents without the game window
+// Follows the same rules as the game in snake.c: the snake starts in the middle of the board facing left with a length of 3,
+// it cant turn back on itself, it dies when it hits a wall or itself and grows by one on the move after eating
+#ifndef SNAKEENV_H
+#define SNAKEENV_H
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint8_t/uint64_t
+
+// Actions (same values as the directions in snake.c)
+#define ENV_NOACTION -1 // Keep going in the current direction
+#define ENV_UP 0
+#define ENV_DOWN 1
+#define ENV_LEFT 2
+#define ENV_RIGHT 3
+
+// Observation planes (each plane is one byte per cell including the walls, set to 1 where the plane applies)
+#define ENV_PLANE_WALLS 0
+#define ENV_PLANE_BODY 1  // Every cell containing the snake (including the front)
+#define ENV_PLANE_HEAD 2  // Front of the snake
+#define ENV_PLANE_FOOD 3
+#define ENV_PLANE_COUNT 4
+
+typedef struct
+{
+    int boardSize;           // Width and height of the playable board (walls are added around it)
+    uint8_t *observation;    // Caller owned buffer of 'env_observation_size' bytes updated in place every step (can be NULL)
+    float foodReward;        // Reward for eating food
+    float deathReward;       // Reward for hitting a wall or the snake
+    float winReward;         // Reward for filling the board
+    float stepReward;        // Reward added to every step
+    int maxStepsWithoutFood; // Ends the episode if the snake goes this many steps without eating (0 for no limit)
+} EnvConfig;
+
+typedef struct SnakeEnv SnakeEnv;
+
+// Everything a single move changed so it can be taken back with env_unmake_move (filled in by env_make_move)
+typedef struct
+{
+    int direction;        // Direction the snake was moving in before the move
+    int enteredCell;      // Cell the front moved into (-1 if the snake died so nothing moved)
+    int vacatedCell;      // Cell the tail moved out of (-1 if the tail stayed still because the snake had eaten)
+    int eatenCell;        // Cell of the food the snake ate (-1 if it didnt eat)
+    int placedFoodCell;   // Cell the new food was placed in after eating (-1 if there was no food placed)
+    int lengthening;      // Moves left of the tail staying still before the move
+    int stepsWithoutFood; // Steps since the snake last ate before the move
+    uint64_t rngState;    // Random number generator state before the move (placing food advances it)
+    bool done;
+    bool won;
+} EnvUndo;
+
+// Returns a config with the default rewards for a board of 'boardSize' by 'boardSize' playable cells
+EnvConfig env_default_config(int boardSize);
+// Bytes needed for the observation buffer of a board (ENV_PLANE_COUNT planes of (boardSize + 2) * (boardSize + 2) cells)
+size_t env_observation_size(int boardSize);
+
+// Creates an environment (the only allocation made by the environment), returns NULL if the config is invalid
+SnakeEnv *env_create(const EnvConfig *config);
+void env_destroy(SnakeEnv *env);
+
+// Starts a new episode using 'seed' for the food placement
+void env_reset(SnakeEnv *env, uint64_t seed);
+// Starts an episode from a position taken from somewhere else (like the game). 'body' lists the cells of the snake from the tail
+// to the front (cells are indexed by y * (boardSize + 2) + x with the walls around the edge), 'foodCell' is -1 if there is no food
+// and 'lengthening' is the number of moves the tail stays still for. The random number generator, tick and steps without food are
+// left as they are. Returns false without changing the environment if the position isnt a snake of connected cells that fits on the board
+bool env_load(SnakeEnv *env, const int *body, int length, int direction, int foodCell, int lengthening, int score);
+// Changes the random number generator state used to place food (a search can use a different seed for each line it plays)
+void env_set_seed(SnakeEnv *env, uint64_t seed);
+// Moves the snake one cell in the direction of 'action' (ENV_UP, ENV_DOWN, ENV_LEFT, ENV_RIGHT or ENV_NOACTION)
+// Turning back on itself is ignored like it is for the player. Once 'done' is set the episode has to be reset
+void env_step(SnakeEnv *env, int action, float *reward, bool *done);
+// Same as env_step but also records what the move changed in 'undo' so a search can walk down a tree of moves without copying the environment
+void env_make_move(SnakeEnv *env, int action, EnvUndo *undo, float *reward, bool *done);
+// Takes back the move recorded in 'undo' (moves have to be taken back in the reverse order they were made)
+void env_unmake_move(SnakeEnv *env, const EnvUndo *undo);
+
+// Episode information
+int env_score(const SnakeEnv *env);     // Score shown in the game (starts at 2 and goes up by one for each food)
+int env_direction(const SnakeEnv *env); // Direction the snake last moved in
+bool env_won(const SnakeEnv *env);      // True if the episode ended with the board full
+uint64_t env_tick(const SnakeEnv *env); // Number of steps taken this episode
+int env_front_cell(const SnakeEnv *env); // Cell containing the front of the snake
+int env_food_cell(const SnakeEnv *env);  // Cell containing the food (-1 if there is none)
+// True if taking 'action' next would make the snake hit a wall or itself
+bool env_is_deadly(const SnakeEnv *env, int action);
+
+#endif
@@ -0,0 +1,449 @@
+#include "snakemcts.h"
+#include <math.h>       // sqrtf/logf
+#include <pthread.h>    // pthread_create
+#include <stdatomic.h>  // atomic_bool
+#include <stdlib.h>     // malloc
+#include <string.h>     // memcpy
+#include <time.h>       // clock_gettime/nanosleep
+#ifdef _WIN32
+#include <windows.h> // GetSystemInfo
+#else
+#include <unistd.h> // sysconf
+#endif
+
+#define NODECAPACITY (1 << 18) // Nodes each thread can add to its tree before it only plays out lines from the leaves
+#define MAXDEPTH 4096          // Most moves in one line (moves down the tree and playout moves together)
+#define DISCOUNT 0.98f         // Rewards further down a line count for less so eating sooner is better
+#define EXPLORATION 1.0f       // How much the search tries moves with few visits over moves with a good average
+#define GREEDYCHANCE 75        // Percentage of playout moves that head towards the food (the rest are random safe moves)
+#define DEATHREWARD -5.0f      // Reward for dying in a line (worth a few foods so the search doesnt trade its life for food)
+#define ENVCACHESIZE 4         // Environments each thread keeps for different board sizes (one for each difficulty in the game)
+
+// Node of the tree for one line of moves from the root
+// Food is placed at random so the same line can lead to different positions, nodes only store the moves (open loop search)
+typedef struct
+{
+    int firstChild;  // Index of the child for ENV_UP (the children for the other directions follow it), -1 if not expanded
+    unsigned visits; // Number of lines played through this node
+    float valueSum;  // Total discounted reward of the lines played through this node
+} MctsNode;
+
+typedef struct
+{
+    MctsBot *bot;
+    pthread_t thread;
+    SnakeEnv *env;                    // Environment the lines are played in (moves are taken back with env_unmake_move after each line)
+    int boardSize;                    // Playable board size 'env' was created for
+    SnakeEnv *envCache[ENVCACHESIZE]; // Environments created for earlier board sizes (so switching board doesnt allocate again)
+    int envCacheSizes[ENVCACHESIZE];  // Playable board size of each cached environment (0 if the slot is unused)
+    int nextEnvCacheSlot;             // Slot replaced when every slot is in use
+    MctsNode *nodes;                  // Tree of this thread (NODECAPACITY nodes allocated once)
+    int nodeCount;                    // Nodes in use in the tree
+    EnvUndo undo[MAXDEPTH];           // Moves made in the current line
+    uint64_t rngState;                // Random number generator for the playouts and the food seeds
+    unsigned searchId;                // Search this worker last started
+    bool finished;                    // Set once the worker has stopped searching (protected by the bots mutex)
+    uint64_t rollouts;                // Lines played in the last search
+    unsigned rootVisits[4];           // Visits of each first move in the last search
+} MctsWorker;
+
+struct MctsBot
+{
+    int threadCount;
+    MctsWorker *workers;
+    pthread_mutex_t mutex;
+    pthread_cond_t startCondition;    // Signalled when there is a new search (or the bot is being destroyed)
+    pthread_cond_t finishedCondition; // Signalled when a worker stops searching
+    unsigned searchId;                // Incremented for every search started
+    bool quit;                        // Set when the workers need to exit
+    atomic_bool stop;                 // Set to make the workers stop searching (checked after every line)
+    bool searching;
+    MctsPosition position; // Position being searched ('body' points to 'body' below)
+    int *body;
+    int bodyCapacity;
+    double startTime;
+};
+
+static double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+static uint64_t nextRandom(uint64_t *state)
+{
+    // splitmix64 (same as snakeenv)
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+static int countCores()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+static bool isOpposite(int direction1, int direction2)
+{
+    return (direction1 ^ direction2) == 1;
+}
+static int distanceToFood(int boardSize, int cell, int direction, int foodCell)
+{
+    // Manhattan distance to the food from the cell next to 'cell' in 'direction' (boardSize includes the walls)
+    int x = cell % boardSize + (direction == ENV_RIGHT) - (direction == ENV_LEFT);
+    int y = cell / boardSize + (direction == ENV_DOWN) - (direction == ENV_UP);
+    return abs(x - foodCell % boardSize) + abs(y - foodCell / boardSize);
+}
+
+static int selectAction(MctsWorker *worker, const MctsNode *node)
+{
+    // Chooses the child to go down with UCT, moves that would kill the snake straight away are only chosen if every move does
+    int direction = env_direction(worker->env);
+    float logVisits = logf((float)node->visits + 1.0f);
+    int bestAction = direction;
+    float bestScore = -INFINITY;
+    for (int action = ENV_UP; action <= ENV_RIGHT; action++)
+    {
+        if (isOpposite(action, direction) || env_is_deadly(worker->env, action))
+            continue;
+        const MctsNode *child = &worker->nodes[node->firstChild + action];
+        if (child->visits == 0) // Try every move once before comparing them
+            return action;
+        float score = child->valueSum / child->visits + EXPLORATION * sqrtf(logVisits / child->visits);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestAction = action;
+        }
+    }
+    return bestAction;
+}
+static int playoutAction(MctsWorker *worker)
+{
+    // Picks a move that doesnt kill the snake straight away, usually the one that heads towards the food
+    SnakeEnv *env = worker->env;
+    int direction = env_direction(env);
+    int front = env_front_cell(env);
+    int food = env_food_cell(env);
+    int safe[3];
+    int safeCount = 0;
+    int greedyAction = ENV_NOACTION;
+    int greedyDistance = 0;
+    for (int action = ENV_UP; action <= ENV_RIGHT; action++)
+    {
+        if (isOpposite(action, direction) || env_is_deadly(env, action))
+            continue;
+        safe[safeCount++] = action;
+        if (food != -1)
+        {
+            int distance = distanceToFood(worker->boardSize + 2, front, action, food);
+            if (greedyAction == ENV_NOACTION || distance < greedyDistance)
+            {
+                greedyAction = action;
+                greedyDistance = distance;
+            }
+        }
+    }
+    if (safeCount == 0)
+        return direction; // Trapped so the line ends here
+    uint64_t random = nextRandom(&worker->rngState);
+    if (greedyAction != ENV_NOACTION && random % 100 < GREEDYCHANCE)
+        return greedyAction;
+    return safe[(random >> 32) % safeCount];
+}
+
+static void playLine(MctsWorker *worker, int playoutLength)
+{
+    // Goes down the tree choosing moves with UCT, adds the children of the leaf it reaches, plays out the rest of the line
+    // with the playout policy and adds the discounted reward to every node it went through before taking every move back
+    SnakeEnv *env = worker->env;
+    int path[MAXDEPTH + 1];
+    int pathLength = 1;
+    int depth = 0;
+    int node = 0;
+    float value = 0.0f;
+    float discount = 1.0f;
+    float reward;
+    bool done = false;
+    path[0] = 0;
+    env_set_seed(env, nextRandom(&worker->rngState)); // Each line sees a different sequence of food
+
+    while (!done && depth < MAXDEPTH)
+    {
+        MctsNode *current = &worker->nodes[node];
+        if (current->firstChild == -1)
+        {
+            // Leaves are expanded on their second visit so lines that are only played once dont use up the nodes
+            if ((current->visits == 0 && node != 0) || worker->nodeCount + 4 > NODECAPACITY)
+                break;
+            current->firstChild = worker->nodeCount;
+            for (int i = 0; i < 4; i++)
+                worker->nodes[worker->nodeCount + i] = (MctsNode){-1, 0, 0.0f};
+            worker->nodeCount += 4;
+        }
+        int action = selectAction(worker, current);
+        env_make_move(env, action, &worker->undo[depth++], &reward, &done);
+        value += discount * reward;
+        discount *= DISCOUNT;
+        node = current->firstChild + action;
+        path[pathLength++] = node;
+    }
+    for (int i = 0; i < playoutLength && !done && depth < MAXDEPTH; i++)
+    {
+        env_make_move(env, playoutAction(worker), &worker->undo[depth++], &reward, &done);
+        value += discount * reward;
+        discount *= DISCOUNT;
+    }
+
+    for (int i = 0; i < pathLength; i++)
+    {
+        worker->nodes[path[i]].visits++;
+        worker->nodes[path[i]].valueSum += value;
+    }
+    while (depth > 0)
+        env_unmake_move(env, &worker->undo[--depth]);
+}
+static void useEnvironment(MctsWorker *worker, int boardSize)
+{
+    // Switches the worker to an environment for 'boardSize', creating one the first time the size is searched
+    worker->env = NULL;
+    worker->boardSize = boardSize;
+    for (int i = 0; i < ENVCACHESIZE; i++)
+    {
+        if (worker->envCacheSizes[i] == boardSize)
+        {
+            worker->env = worker->envCache[i];
+            return;
+        }
+    }
+    int slot = worker->nextEnvCacheSlot;
+    worker->nextEnvCacheSlot = (slot + 1) % ENVCACHESIZE;
+    env_destroy(worker->envCache[slot]);
+    EnvConfig config = env_default_config(boardSize);
+    config.deathReward = DEATHREWARD;
+    worker->envCache[slot] = env_create(&config);
+    worker->envCacheSizes[slot] = worker->envCache[slot] != NULL ? boardSize : 0;
+    worker->env = worker->envCache[slot];
+}
+static void searchPosition(MctsWorker *worker, const MctsPosition *position)
+{
+    MctsBot *bot = worker->bot;
+    worker->rollouts = 0;
+    for (int i = 0; i < 4; i++)
+        worker->rootVisits[i] = 0;
+
+    if (worker->env == NULL || worker->boardSize != position->boardSize)
+        useEnvironment(worker, position->boardSize);
+    if (worker->env == NULL || !env_load(worker->env, position->body, position->length, position->direction, position->foodCell, position->lengthening, position->score))
+        return;
+
+    worker->nodeCount = 1;
+    worker->nodes[0] = (MctsNode){-1, 0, 0.0f};
+    int playoutLength = position->boardSize * 3; // Long enough to reach the food from anywhere on the board
+    while (!atomic_load_explicit(&bot->stop, memory_order_relaxed))
+    {
+        playLine(worker, playoutLength);
+        worker->rollouts++;
+    }
+
+    if (worker->nodes[0].firstChild != -1)
+    {
+        for (int i = 0; i < 4; i++)
+            worker->rootVisits[i] = worker->nodes[worker->nodes[0].firstChild + i].visits;
+    }
+}
+static void *workerThread(void *argument)
+{
+    // Waits for a search to be started, searches until it is stopped and then waits for the next one
+    MctsWorker *worker = (MctsWorker *)argument;
+    MctsBot *bot = worker->bot;
+    pthread_mutex_lock(&bot->mutex);
+    for (;;)
+    {
+        while (!bot->quit && worker->searchId == bot->searchId)
+            pthread_cond_wait(&bot->startCondition, &bot->mutex);
+        if (bot->quit)
+            break;
+        worker->searchId = bot->searchId;
+        MctsPosition position = bot->position;
+        pthread_mutex_unlock(&bot->mutex);
+
+        searchPosition(worker, &position);
+
+        pthread_mutex_lock(&bot->mutex);
+        worker->finished = true;
+        pthread_cond_signal(&bot->finishedCondition);
+    }
+    pthread_mutex_unlock(&bot->mutex);
+    return NULL;
+}
+
+MctsBot *mcts_create(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = countCores();
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    MctsBot *bot = (MctsBot *)calloc(1, sizeof(MctsBot));
+    if (bot == NULL)
+        return NULL;
+    bot->workers = (MctsWorker *)calloc(threadCount, sizeof(MctsWorker));
+    if (bot->workers == NULL)
+    {
+        free(bot);
+        return NULL;
+    }
+    pthread_mutex_init(&bot->mutex, NULL);
+    pthread_cond_init(&bot->startCondition, NULL);
+    pthread_cond_init(&bot->finishedCondition, NULL);
+    atomic_init(&bot->stop, false);
+
+    // Workers that cant be started are left out
+    uint64_t seed = (uint64_t)(getSeconds() * 1000000.0);
+    for (int i = 0; i < threadCount; i++)
+    {
+        MctsWorker *worker = &bot->workers[bot->threadCount];
+        worker->bot = bot;
+        worker->rngState = seed + i * 0x9E3779B97F4A7C15ull;
+        worker->finished = true;
+        worker->nodes = (MctsNode *)malloc(NODECAPACITY * sizeof(MctsNode));
+        if (worker->nodes == NULL || pthread_create(&worker->thread, NULL, workerThread, worker) != 0)
+        {
+            free(worker->nodes);
+            worker->nodes = NULL;
+            break;
+        }
+        bot->threadCount++;
+    }
+    if (bot->threadCount == 0)
+    {
+        mcts_destroy(bot);
+        return NULL;
+    }
+    return bot;
+}
+void mcts_destroy(MctsBot *bot)
+{
+    if (bot == NULL)
+        return;
+    mcts_stop(bot, NULL);
+    pthread_mutex_lock(&bot->mutex);
+    bot->quit = true;
+    pthread_cond_broadcast(&bot->startCondition);
+    pthread_mutex_unlock(&bot->mutex);
+    for (int i = 0; i < bot->threadCount; i++)
+    {
+        pthread_join(bot->workers[i].thread, NULL);
+        for (int j = 0; j < ENVCACHESIZE; j++)
+            env_destroy(bot->workers[i].envCache[j]);
+        free(bot->workers[i].nodes);
+    }
+    pthread_mutex_destroy(&bot->mutex);
+    pthread_cond_destroy(&bot->startCondition);
+    pthread_cond_destroy(&bot->finishedCondition);
+    free(bot->workers);
+    free(bot->body);
+    free(bot);
+}
+
+bool mcts_start(MctsBot *bot, const MctsPosition *position)
+{
+    mcts_stop(bot, NULL);
+    if (position->boardSize < 6 || position->length < 1 || position->length > position->boardSize * position->boardSize)
+        return false;
+
+    // Workers are all waiting so the position can be changed without them seeing half of it
+    // Space is made for a snake filling the board so a growing snake doesnt need a new allocation every time it eats
+    if (position->length > bot->bodyCapacity)
+    {
+        int capacity = position->boardSize * position->boardSize;
+        int *body = (int *)realloc(bot->body, capacity * sizeof(int));
+        if (body == NULL)
+            return false;
+        bot->body = body;
+        bot->bodyCapacity = capacity;
+    }
+    memcpy(bot->body, position->body, position->length * sizeof(int));
+
+    pthread_mutex_lock(&bot->mutex);
+    bot->position = *position;
+    bot->position.body = bot->body;
+    atomic_store(&bot->stop, false);
+    for (int i = 0; i < bot->threadCount; i++)
+        bot->workers[i].finished = false;
+    bot->searchId++;
+    bot->searching = true;
+    bot->startTime = getSeconds();
+    pthread_cond_broadcast(&bot->startCondition);
+    pthread_mutex_unlock(&bot->mutex);
+    return true;
+}
+int mcts_stop(MctsBot *bot, MctsStats *stats)
+{
+    if (stats != NULL)
+        *stats = (MctsStats){ENV_NOACTION, bot->threadCount, 0, 0.0, 0.0};
+    if (!bot->searching)
+        return ENV_NOACTION;
+
+    // Wait for every worker to finish the line it is on
+    atomic_store(&bot->stop, true);
+    pthread_mutex_lock(&bot->mutex);
+    for (int i = 0; i < bot->threadCount; i++)
+    {
+        while (!bot->workers[i].finished)
+            pthread_cond_wait(&bot->finishedCondition, &bot->mutex);
+    }
+    bot->searching = false;
+    pthread_mutex_unlock(&bot->mutex);
+    double seconds = getSeconds() - bot->startTime;
+
+    // Add up the visits of each first move across the threads
+    unsigned visits[4] = {0, 0, 0, 0};
+    uint64_t rollouts = 0;
+    for (int i = 0; i < bot->threadCount; i++)
+    {
+        for (int action = 0; action < 4; action++)
+            visits[action] += bot->workers[i].rootVisits[action];
+        rollouts += bot->workers[i].rollouts;
+    }
+    int direction = ENV_NOACTION;
+    for (int action = ENV_UP; action <= ENV_RIGHT; action++)
+    {
+        if (visits[action] > 0 && (direction == ENV_NOACTION || visits[action] > visits[direction]))
+            direction = action;
+    }
+
+    if (stats != NULL)
+    {
+        stats->direction = direction;
+        stats->rollouts = rollouts;
+        stats->seconds = seconds;
+        stats->rolloutsPerSecond = seconds > 0.0 ? rollouts / seconds : 0.0;
+    }
+    return direction;
+}
+int mcts_search(MctsBot *bot, const MctsPosition *position, double seconds, MctsStats *stats)
+{
+    if (!mcts_start(bot, position))
+        return mcts_stop(bot, stats);
+    struct timespec wait;
+    wait.tv_sec = (time_t)seconds;
+    wait.tv_nsec = (long)((seconds - wait.tv_sec) * 1000000000.0);
+    nanosleep(&wait, NULL);
+    return mcts_stop(bot, stats);
+}
+bool mcts_is_searching(const MctsBot *bot)
+{
+    return bot->searching;
+}
+int mcts_thread_count(const MctsBot *bot)
+{
+    return bot->threadCount;
+}
@@ -0,0 +1,46 @@
+// Monte Carlo tree search bot that plays the headless rules in snakeenv on every CPU core
+// Each worker thread grows its own tree from the same position (root parallelism) so the threads never have to share or lock
+// anything while searching, the visits of the first moves are added together when the search is stopped to choose the direction
+// The search is anytime: it keeps improving until it is stopped so it can be given whatever time is left before the snake moves
+#ifndef SNAKEMCTS_H
+#define SNAKEMCTS_H
+
+#include "snakeenv.h"
+
+// Position to search from (same cell indexes and directions as snakeenv)
+typedef struct
+{
+    int boardSize;   // Width and height of the playable board (walls are added around it)
+    const int *body; // Cells of the snake from the tail to the front (only read by mcts_start)
+    int length;      // Number of cells in 'body'
+    int direction;   // Direction the snake last moved in
+    int foodCell;    // Cell containing the food (-1 if there is none)
+    int lengthening; // Moves left where the tail stays still because the snake has eaten
+    int score;       // Score shown in the game
+} MctsPosition;
+
+typedef struct
+{
+    int direction;            // Direction chosen by the search (ENV_NOACTION if there was no search running)
+    int threadCount;          // Number of threads that searched
+    uint64_t rollouts;        // Lines played out by every thread together
+    double seconds;           // Time between the search starting and stopping
+    double rolloutsPerSecond; // 'rollouts' / 'seconds'
+} MctsStats;
+
+typedef struct MctsBot MctsBot;
+
+// Starts 'threadCount' worker threads (0 uses one for each CPU core) which wait for a position to search
+MctsBot *mcts_create(int threadCount);
+void mcts_destroy(MctsBot *bot);
+
+// Starts searching 'position' in the background (any search already running is stopped first), returns false if the position is invalid
+bool mcts_start(MctsBot *bot, const MctsPosition *position);
+// Stops the search and returns the direction with the most visits (ENV_NOACTION if no search was running)
+int mcts_stop(MctsBot *bot, MctsStats *stats);
+// Searches 'position' for 'seconds' and returns the chosen direction (same as mcts_start, waiting and then mcts_stop)
+int mcts_search(MctsBot *bot, const MctsPosition *position, double seconds, MctsStats *stats);
+bool mcts_is_searching(const MctsBot *bot);
+int mcts_thread_count(const MctsBot *bot); // Number of worker threads that were started
+
+#endif
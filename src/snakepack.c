@@ -0,0 +1,142 @@
+// Packs every sprite and sound in the resources folder into one bundle the game can map without decoding anything (see snakebundle.h)
+// Usage: snakepack [resources folder] [bundle file]
+// Sprites are stored as 8 bit RGBA pixels and sounds as the PCM samples raylib decodes them to
+#include "raylib.h"      // LoadImage/LoadWave/LoadDirectoryFilesEx
+#include "snakebundle.h" // Bundle layout
+#include <stdio.h>       // fopen/fwrite
+#include <stdlib.h>      // calloc
+#include <string.h>      // strncpy
+
+// Decoded file waiting to be written
+typedef struct
+{
+    BundleEntry entry;
+    Image image;
+    Wave wave;
+} PackedFile;
+
+uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + BUNDLE_ALIGNMENT - 1) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+}
+
+bool packFile(const char *path, PackedFile *file)
+{
+    // Decodes one file into 'file', returns false if it isnt a sprite or sound
+    memset(file, 0, sizeof(PackedFile));
+    if (strlen(path) >= BUNDLE_NAME_LENGTH)
+    {
+        printf("Skipping %s (name is too long)\n", path);
+        return false;
+    }
+    strncpy(file->entry.name, path, BUNDLE_NAME_LENGTH - 1);
+    for (char *c = file->entry.name; *c != '\0'; c++) // The game looks files up with forward slashes
+    {
+        if (*c == '\\')
+            *c = '/';
+    }
+
+    if (IsFileExtension(path, ".png"))
+    {
+        file->image = LoadImage(path);
+        if (file->image.data == NULL)
+            return false;
+        ImageFormat(&file->image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8); // Ready to upload without converting
+        file->entry.kind = BUNDLE_IMAGE;
+        file->entry.width = file->image.width;
+        file->entry.height = file->image.height;
+        file->entry.format = file->image.format;
+        file->entry.size = (uint64_t)GetPixelDataSize(file->image.width, file->image.height, file->image.format);
+        return true;
+    }
+    if (IsFileExtension(path, ".wav"))
+    {
+        file->wave = LoadWave(path);
+        if (file->wave.data == NULL)
+            return false;
+        file->entry.kind = BUNDLE_WAVE;
+        file->entry.frameCount = file->wave.frameCount;
+        file->entry.sampleRate = file->wave.sampleRate;
+        file->entry.sampleSize = file->wave.sampleSize;
+        file->entry.channels = file->wave.channels;
+        file->entry.size = (uint64_t)file->wave.frameCount * file->wave.channels * (file->wave.sampleSize / 8);
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *resourcesPath = argc > 1 ? argv[1] : "resources";
+    const char *bundlePath = argc > 2 ? argv[2] : BUNDLE_DEFAULT_NAME;
+    SetTraceLogLevel(LOG_WARNING);
+
+    // Decode every sprite and sound (file names are kept relative to the game folder like the game loads them)
+    FilePathList paths = LoadDirectoryFilesEx(resourcesPath, ".png;.wav", true);
+    PackedFile *files = (PackedFile *)calloc(paths.count > 0 ? paths.count : 1, sizeof(PackedFile));
+    uint32_t fileCount = 0;
+    for (unsigned i = 0; i < paths.count; i++)
+    {
+        if (packFile(paths.paths[i], &files[fileCount]))
+            fileCount++;
+    }
+    UnloadDirectoryFiles(paths);
+    if (fileCount == 0)
+    {
+        printf("No sprites or sounds found in %s\n", resourcesPath);
+        free(files);
+        return 1;
+    }
+
+    // Lay out the data after the index
+    uint64_t offset = alignOffset(sizeof(BundleHeader) + fileCount * sizeof(BundleEntry));
+    for (uint32_t i = 0; i < fileCount; i++)
+    {
+        files[i].entry.offset = offset;
+        offset = alignOffset(offset + files[i].entry.size);
+    }
+    BundleHeader header = {BUNDLE_MAGIC, BUNDLE_VERSION, fileCount, offset};
+
+    FILE *output = fopen(bundlePath, "wb");
+    if (output == NULL)
+    {
+        printf("Could not create %s\n", bundlePath);
+        free(files);
+        return 1;
+    }
+    static const char padding[BUNDLE_ALIGNMENT] = {0};
+    bool written = fwrite(&header, sizeof(header), 1, output) == 1;
+    uint64_t position = sizeof(header);
+    for (uint32_t i = 0; i < fileCount && written; i++)
+    {
+        written = fwrite(&files[i].entry, sizeof(BundleEntry), 1, output) == 1;
+        position += sizeof(BundleEntry);
+    }
+    for (uint32_t i = 0; i <= fileCount && written; i++)
+    {
+        // Pad up to the start of the entry (or the end of the file after the last entry)
+        uint64_t start = i < fileCount ? files[i].entry.offset : header.totalSize;
+        written = fwrite(padding, 1, start - position, output) == start - position;
+        position = start;
+        if (i == fileCount || !written)
+            break;
+        const void *data = files[i].entry.kind == BUNDLE_IMAGE ? files[i].image.data : files[i].wave.data;
+        written = fwrite(data, 1, files[i].entry.size, output) == files[i].entry.size;
+        position += files[i].entry.size;
+    }
+    written = fclose(output) == 0 && written;
+
+    for (uint32_t i = 0; i < fileCount; i++)
+    {
+        UnloadImage(files[i].image);
+        UnloadWave(files[i].wave);
+    }
+    free(files);
+    if (!written)
+    {
+        printf("Could not write %s\n", bundlePath);
+        return 1;
+    }
+    printf("Packed %u files into %s (%llu bytes)\n", fileCount, bundlePath, (unsigned long long)header.totalSize);
+    return 0;
+}
@@ -0,0 +1,216 @@
+// Runs snake environments for trainers in other processes through POSIX shared memory (see snakeshm.h)
+// Usage: snakeserver [--envs N] [--board SIZE] [--name /shmname] [--spin COUNT] [--bench STEPS]
+#include "snakeshm.h"
+#include <signal.h>   // sigaction
+#include <stdio.h>    // printf
+#include <stdlib.h>   // atoi
+#include <string.h>   // strcmp/memset
+#include <sys/wait.h> // waitpid
+#include <time.h>     // clock_gettime
+
+ShmHeader *serverHeader = NULL;
+volatile sig_atomic_t stopRequested = 0;
+
+void handleStopSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+    if (serverHeader != NULL)
+        shm_ring(&serverHeader->request); // Wake the server if it is asleep waiting for a request
+}
+
+double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+void runBenchmark(const char *name, int steps)
+{
+    // Acts as a trainer in a separate process and reports the cost of a step round trip
+    ShmHeader *header = shm_connect(name);
+    if (header == NULL)
+    {
+        printf("Benchmark could not connect to %s\n", name);
+        return;
+    }
+    ShmEnvSlot *slots = shm_slots(header);
+    for (uint32_t i = 0; i < header->envCount; i++)
+    {
+        slots[i].action = SHM_ACTION_RESET;
+        slots[i].seed = i;
+    }
+    if (!shm_step(header))
+    {
+        printf("Server stopped before the benchmark started\n");
+        shm_disconnect(header);
+        return;
+    }
+
+    double startTime = getSeconds();
+    int episodes = 0;
+    int step;
+    for (step = 0; step < steps; step++)
+    {
+        for (uint32_t i = 0; i < header->envCount; i++)
+        {
+            if (slots[i].done)
+            {
+                slots[i].action = SHM_ACTION_RESET;
+                slots[i].seed = (uint64_t)step * header->envCount + i;
+                episodes++;
+            }
+            else
+                slots[i].action = (step / 4 + i) % 4; // Turns every few steps so episodes end and get reset
+        }
+        if (!shm_step(header))
+        {
+            printf("Server stopped after %d steps\n", step);
+            break;
+        }
+    }
+    double elapsed = getSeconds() - startTime;
+    if (step > 0)
+        printf("%u environments (%ux%u): %.2f us per step round trip, %.0f environment steps per second, %d episodes\n",
+               header->envCount, header->boardSize, header->boardSize, elapsed / step * 1000000.0, (double)step * header->envCount / elapsed, episodes);
+    shm_disconnect(header);
+}
+
+int main(int argc, char *argv[])
+{
+    int envCount = 16;
+    int boardSize = 16;
+    int spinCount = shm_default_spin_count();
+    int benchmarkSteps = 0;
+    const char *name = SHM_DEFAULT_NAME;
+
+    // Command line options
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--envs") == 0 && i + 1 < argc)
+            envCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+            boardSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+            name = argv[++i];
+        else if (strcmp(argv[i], "--spin") == 0 && i + 1 < argc)
+            spinCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) // Run a trainer in a child process and report the step cost
+            benchmarkSteps = atoi(argv[++i]);
+    }
+    if (envCount < 1 || boardSize < 6)
+    {
+        printf("Need at least 1 environment and a board size of at least 6\n");
+        return 1;
+    }
+
+    // Create and map the shared memory region
+    uint64_t slotsOffset, observationsOffset;
+    uint64_t totalSize = shm_region_size(envCount, boardSize, &slotsOffset, &observationsOffset);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, totalSize) != 0)
+    {
+        perror("shm_open");
+        return 1;
+    }
+    ShmHeader *header = (ShmHeader *)mmap(NULL, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+    {
+        perror("mmap");
+        shm_unlink(name);
+        return 1;
+    }
+    memset(header, 0, totalSize);
+    header->version = SHM_VERSION;
+    header->envCount = envCount;
+    header->boardSize = boardSize;
+    header->observationSize = env_observation_size(boardSize);
+    header->slotsOffset = slotsOffset;
+    header->observationsOffset = observationsOffset;
+    header->totalSize = totalSize;
+
+    // Environments write their observations straight into the shared region
+    SnakeEnv **envs = (SnakeEnv **)malloc(envCount * sizeof(SnakeEnv *));
+    ShmEnvSlot *slots = shm_slots(header);
+    for (int i = 0; i < envCount; i++)
+    {
+        EnvConfig config = env_default_config(boardSize);
+        config.observation = shm_observation(header, i);
+        envs[i] = env_create(&config);
+        if (envs[i] == NULL)
+        {
+            printf("Could not create environment %d\n", i);
+            for (int j = 0; j < i; j++)
+                env_destroy(envs[j]);
+            free(envs);
+            munmap(header, totalSize);
+            shm_unlink(name);
+            return 1;
+        }
+        env_reset(envs[i], i);
+        slots[i].action = ENV_NOACTION;
+        slots[i].score = env_score(envs[i]);
+    }
+    atomic_thread_fence(memory_order_release);
+    header->magic = SHM_MAGIC; // Written last so trainers cant connect to a half set up region
+
+    serverHeader = header;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleStopSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    pid_t benchmarkProcess = -1;
+    if (benchmarkSteps > 0)
+    {
+        benchmarkProcess = fork();
+        if (benchmarkProcess == 0)
+        {
+            runBenchmark(name, benchmarkSteps);
+            kill(getppid(), SIGTERM); // Stop the server once the benchmark is done
+            return 0;
+        }
+    }
+    else
+        printf("Serving %d environments (%dx%d) on %s\n", envCount, boardSize, boardSize, name);
+
+    // Step every environment each time the trainer rings the request doorbell
+    unsigned requestSequence = 0;
+    while (!stopRequested)
+    {
+        requestSequence = shm_wait(&header->request, requestSequence, spinCount, NULL); // Woken by the stop signal
+        if (stopRequested)
+            break;
+
+        for (int i = 0; i < envCount; i++)
+        {
+            bool done = false;
+            if (slots[i].action == SHM_ACTION_RESET)
+            {
+                env_reset(envs[i], slots[i].seed);
+                slots[i].reward = 0.0f;
+            }
+            else
+                env_step(envs[i], slots[i].action, &slots[i].reward, &done);
+            slots[i].done = done;
+            slots[i].won = env_won(envs[i]);
+            slots[i].score = env_score(envs[i]);
+        }
+        shm_ring(&header->response);
+    }
+
+    // Let any trainer waiting on a step know the server has gone
+    atomic_store(&header->shutdown, 1);
+    shm_ring(&header->response);
+    if (benchmarkProcess > 0)
+        waitpid(benchmarkProcess, NULL, 0);
+    for (int i = 0; i < envCount; i++)
+        env_destroy(envs[i]);
+    free(envs);
+    munmap(header, totalSize);
+    shm_unlink(name);
+    return 0;
+}
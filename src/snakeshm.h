@@ -0,0 +1,153 @@
+// Shared memory layout used by snakeserver to run environments for trainers in another process (Linux only)
+// The trainer writes an action into the slot of each environment and rings the request doorbell, the server steps
+// every environment with env_step, writes the rewards, done flags and observations in place and rings the response doorbell
+#ifndef SNAKESHM_H
+#define SNAKESHM_H
+
+#include "snakeenv.h"
+#include <fcntl.h>         // O_RDWR
+#include <linux/futex.h>   // FUTEX_WAIT/FUTEX_WAKE
+#include <sched.h>         // sched_yield
+#include <stdatomic.h>     // atomic_uint
+#include <sys/mman.h>      // shm_open/mmap
+#include <sys/syscall.h>   // SYS_futex
+#include <unistd.h>        // syscall/close
+
+#define SHM_MAGIC 0x564e454b414e53ull // "SNAKENV"
+#define SHM_VERSION 1
+#define SHM_DEFAULT_NAME "/snakeenv"
+#define SHM_ACTION_RESET -2 // Resets the environment with the seed in its slot instead of stepping it
+#define SHM_SPIN_COUNT 4000 // Times to check a doorbell before backing off (only spins when there is more than one CPU)
+#define SHM_YIELD_COUNT 16  // Times to give up the CPU while waiting on a doorbell before sleeping on it
+
+// Counter that one process increments and the other waits to change (each on its own cache line)
+typedef struct
+{
+    _Alignas(64) atomic_uint sequence; // Incremented every time the doorbell is rung
+    atomic_uint waiters;               // Number of processes asleep on 'sequence' (the doorbell only wakes them if this isnt 0)
+} ShmDoorbell;
+
+// Per environment data passed between the trainer and the server
+typedef struct
+{
+    int32_t action;  // Written by the trainer (ENV_UP, ENV_DOWN, ENV_LEFT, ENV_RIGHT, ENV_NOACTION or SHM_ACTION_RESET)
+    int32_t score;   // Written by the server
+    uint64_t seed;   // Written by the trainer, used when 'action' is SHM_ACTION_RESET
+    float reward;    // Written by the server
+    uint8_t done;    // Written by the server, the environment has to be reset once it is set
+    uint8_t won;     // Written by the server
+} ShmEnvSlot;
+
+typedef struct
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t envCount;
+    uint32_t boardSize;          // Playable board size of every environment
+    uint32_t observationSize;    // Bytes of observation for each environment (see env_observation_size)
+    uint64_t slotsOffset;        // Offset in bytes from the start of the region to the ShmEnvSlot array
+    uint64_t observationsOffset; // Offset in bytes from the start of the region to the observations (one after another)
+    uint64_t totalSize;          // Size of the whole region in bytes
+    atomic_uint shutdown;        // Set by the server when it stops
+    ShmDoorbell request;         // Rung by the trainer once the actions have been written
+    ShmDoorbell response;        // Rung by the server once every environment has been stepped
+} ShmHeader;
+
+static inline uint64_t shm_region_size(uint32_t envCount, uint32_t boardSize, uint64_t *slotsOffset, uint64_t *observationsOffset)
+{
+    // Works out where each part of the region goes (each part starts on its own cache line)
+    uint64_t slots = (sizeof(ShmHeader) + 63) / 64 * 64;
+    uint64_t observations = (slots + envCount * sizeof(ShmEnvSlot) + 63) / 64 * 64;
+    if (slotsOffset != NULL)
+        *slotsOffset = slots;
+    if (observationsOffset != NULL)
+        *observationsOffset = observations;
+    return observations + (uint64_t)envCount * env_observation_size(boardSize);
+}
+static inline ShmEnvSlot *shm_slots(ShmHeader *header)
+{
+    return (ShmEnvSlot *)((char *)header + header->slotsOffset);
+}
+static inline uint8_t *shm_observation(ShmHeader *header, uint32_t env)
+{
+    return (uint8_t *)header + header->observationsOffset + (uint64_t)env * header->observationSize;
+}
+
+static inline void shm_ring(ShmDoorbell *doorbell)
+{
+    atomic_fetch_add(&doorbell->sequence, 1);
+    if (atomic_load(&doorbell->waiters) != 0) // Only make the system call if the other side has gone to sleep
+        syscall(SYS_futex, &doorbell->sequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+static inline int shm_default_spin_count()
+{
+    // Spinning only helps if the other process can run at the same time
+    static int spinCount = -1;
+    if (spinCount == -1)
+        spinCount = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_COUNT : 0;
+    return spinCount;
+}
+static inline unsigned shm_wait(ShmDoorbell *doorbell, unsigned lastSequence, int spinCount, atomic_uint *shutdown)
+{
+    // Waits for the doorbell to be rung after 'lastSequence' and returns the new sequence
+    // Also returns (with 'lastSequence') once '*shutdown' is set so nothing waits on a process that has gone ('shutdown' can be NULL)
+    // Spins for a while first as a step usually finishes in a few microseconds, then backs off by yielding and finally sleeps on a futex
+    for (int i = 0; i < spinCount + SHM_YIELD_COUNT; i++)
+    {
+        unsigned sequence = atomic_load_explicit(&doorbell->sequence, memory_order_acquire);
+        if (sequence != lastSequence || (shutdown != NULL && atomic_load(shutdown)))
+            return sequence;
+        if (i >= spinCount)
+            sched_yield();
+#if defined(__x86_64__) || defined(__i386__)
+        else
+            __builtin_ia32_pause();
+#endif
+    }
+    for (;;)
+    {
+        atomic_fetch_add(&doorbell->waiters, 1);
+        unsigned sequence = atomic_load(&doorbell->sequence);
+        if (sequence == lastSequence && (shutdown == NULL || !atomic_load(shutdown))) // Shutting down rings the doorbell after setting the flag so the wait cant miss it
+            syscall(SYS_futex, &doorbell->sequence, FUTEX_WAIT, lastSequence, NULL, NULL, 0);
+        atomic_fetch_sub(&doorbell->waiters, 1);
+        sequence = atomic_load_explicit(&doorbell->sequence, memory_order_acquire);
+        if (sequence != lastSequence || (shutdown != NULL && atomic_load(shutdown)))
+            return sequence;
+    }
+}
+
+// Trainer side
+static inline ShmHeader *shm_connect(const char *name)
+{
+    // Maps the region created by snakeserver, returns NULL if it doesnt exist or doesnt match this header
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+    ShmHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != SHM_MAGIC || header.version != SHM_VERSION)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *region = mmap(NULL, header.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return region == MAP_FAILED ? NULL : (ShmHeader *)region;
+}
+static inline void shm_disconnect(ShmHeader *header)
+{
+    munmap(header, header->totalSize);
+}
+static inline bool shm_step(ShmHeader *header)
+{
+    // Steps every environment using the actions in the slots and waits for the results
+    // Returns false if the server has stopped (the slots dont hold the results of this step and the region should be disconnected)
+    if (atomic_load(&header->shutdown))
+        return false;
+    unsigned sequence = atomic_load(&header->response.sequence);
+    shm_ring(&header->request);
+    shm_wait(&header->response, sequence, shm_default_spin_count(), &header->shutdown);
+    return !atomic_load(&header->shutdown);
+}
+
+#endif
@@ -0,0 +1,83 @@
+// Headless check that the game doesnt allocate from the heap while playing or starting a new game
+// Plays games on every difficulty with the autopilot and the solver (with quick saves and loads) without opening a window
+// and exits with 1 as soon as a tick or a reset changes 'heapAllocationCount'
+// Built with COUNTALLOCATIONS so every allocation in the program is counted (see the README for the command)
+#define main snakeMain
+#include "snake.c"
+#undef main
+
+#define TESTGAMES 12         // Games played (each difficulty with each autopilot that cant lose track of the board)
+#define TESTTICKS 20000      // Most snake moves played in one game before starting the next
+#define TESTSAVEINTERVAL 500 // Snake moves between quick saves (loaded again halfway to the next save)
+
+size_t lastAllocationSize = 0; // Size of the last counted allocation (set by the allocation hook so a failure can say what was asked for)
+
+void recordAllocation(size_t size)
+{
+    lastAllocationSize = size; // Mustnt allocate itself
+}
+bool checkNoAllocations(uint64_t countBefore, const char *what, int game, int tick)
+{
+    // Returns false after reporting it if anything was allocated since 'countBefore' was read
+    uint64_t count = atomic_load(&heapAllocationCount);
+    if (count == countBefore)
+        return true;
+    printf("FAIL: %llu heap allocations during %s (game %d, tick %d, last one %zu bytes)\n", (unsigned long long)(count - countBefore), what, game, tick, lastAllocationSize);
+    return false;
+}
+int main()
+{
+    // Same setup as the game (everything a session needs is carved from the arena here)
+    rngState = 1;
+    boardSize = 16 + 2; // Biggest board of any difficulty with its walls
+    createSessionArena();
+    Cell(*board)[boardSize] = gameAlloc(boardSize * boardSize * sizeof(Cell));
+    quickSave = gameAlloc(gameSnapshotSize());
+    mctsBody = gameAlloc(boardSize * boardSize * sizeof(int));
+    Snake snake;
+    snake.snakeSegments = gameAlloc(boardSize * boardSize * sizeof(Cell *));
+    snake.segmentCapacity = boardSize * boardSize;
+    snake.tailIndex = 0;
+    float snakeUpdateBaseInterval;
+    float snakeUpdateInterval = 0.0f;
+    float lastSnakeUpdateTime;
+    int cellSize;
+    Position boardStart;
+    setDifficultySettings(1, &snakeUpdateBaseInterval);
+    initBoardSizes(&cellSize, &boardStart);
+    initGame(&snake, board);
+    printf("Checking allocations over %d games\n", TESTGAMES); // Also gives stdout its buffer before counting starts
+
+    allocationHook = recordAllocation;
+    long moves = 0;
+    for (int game = 0; game < TESTGAMES; game++)
+    {
+        uint64_t countBefore = atomic_load(&heapAllocationCount);
+        autopilotMode = game % 3 == 2 ? HAMILTONIAN : PATHFINDER;
+        setDifficultySettings(game % 4, &snakeUpdateBaseInterval);
+        initBoardSizes(&cellSize, &boardStart);
+        resetGame(&snake, board, GAME);
+        if (!checkNoAllocations(countBefore, "a reset", game, 0))
+            return 1;
+
+        for (int tick = 0; tick < TESTTICKS && gameState == GAME; tick++)
+        {
+            countBefore = atomic_load(&heapAllocationCount);
+            lastSnakeUpdateTime = -1000.0f; // Time for the snake to move (without a window 'GetTime' stays at 0)
+            autopilotInputs(&snake, board, 0.0);
+            setAnimationFrame(lastSnakeUpdateTime, snakeUpdateInterval);
+            moveSnake(&lastSnakeUpdateTime, snakeUpdateBaseInterval, &snakeUpdateInterval, 0.001f, board, &snake);
+            updateBoardForSnake(&snake);
+            updateParticles(1.0f / FULLFPS);
+            if (gameState == GAME && tick % TESTSAVEINTERVAL == 0)
+                saveGameSnapshot(&snake, quickSave);
+            else if (gameState == GAME && tick % TESTSAVEINTERVAL == TESTSAVEINTERVAL / 2)
+                restoreGameSnapshot(&snake, board, quickSave);
+            if (!checkNoAllocations(countBefore, "a tick", game, tick))
+                return 1;
+            moves++;
+        }
+    }
+    printf("OK: no heap allocations over %ld snake moves and %d resets\n", moves, TESTGAMES);
+    return 0;
+}